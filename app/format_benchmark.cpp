@@ -0,0 +1,80 @@
+/*******************************************************************************
+ * app/format_benchmark.cpp
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "text_format.h"
+#include "timer.h"
+
+using namespace kagen;
+
+// Compare fprintf based edge output with the table-driven formatter
+// Usage: format_benchmark [num_edges] [log_n] [output file]
+int main(int argn, char **argv) {
+  SInt num_edges = argn > 1 ? std::stoull(argv[1]) : (SInt)1 << 24;
+  SInt log_n = argn > 2 ? std::stoull(argv[2]) : 32;
+  std::string output = argn > 3 ? argv[3] : "/dev/null";
+
+  std::mt19937_64 gen(1);
+  std::uniform_int_distribution<SInt> dist(1, ((SInt)1 << log_n) - 1);
+  std::vector<SInt> ids(2 * num_edges);
+  for (auto &id : ids) id = dist(gen);
+
+  Timer timer;
+  FILE *fout = fopen(output.c_str(), "w");
+  for (SInt i = 0; i < num_edges; ++i) {
+    fprintf(fout, "e %llu %llu\n", ids[2 * i], ids[2 * i + 1]);
+  }
+  fclose(fout);
+  double fprintf_time = timer.Elapsed();
+
+  // Format into large buffers
+  const SInt buffer_size = (SInt)1 << 24;
+  std::vector<char> buffer(buffer_size);
+  SInt bytes = 0;
+  timer.Restart();
+  fout = fopen(output.c_str(), "w");
+  char *pos = buffer.data();
+  for (SInt i = 0; i < num_edges; ++i) {
+    if (pos + TextFormat::MAX_DIMACS_EDGE_BYTES > buffer.data() + buffer_size) {
+      fwrite(buffer.data(), 1, pos - buffer.data(), fout);
+      bytes += pos - buffer.data();
+      pos = buffer.data();
+    }
+    pos = TextFormat::WriteDimacsEdge(pos, ids[2 * i], ids[2 * i + 1]);
+  }
+  fwrite(buffer.data(), 1, pos - buffer.data(), fout);
+  bytes += pos - buffer.data();
+  fclose(fout);
+  double format_time = timer.Elapsed();
+
+  // Formatting only (no I/O)
+  timer.Restart();
+  pos = buffer.data();
+  SInt checksum = 0;
+  for (SInt i = 0; i < num_edges; ++i) {
+    if (pos + TextFormat::MAX_DIMACS_EDGE_BYTES > buffer.data() + buffer_size) {
+      checksum += pos[-2];
+      pos = buffer.data();
+    }
+    pos = TextFormat::WriteDimacsEdge(pos, ids[2 * i], ids[2 * i + 1]);
+  }
+  double memory_time = timer.Elapsed();
+
+  double mb = bytes / (1024.0 * 1024.0);
+  printf("edges=%llu bytes=%llu checksum=%llu\n", num_edges, bytes, checksum);
+  printf("fprintf:    %.3fs (%.1f MB/s)\n", fprintf_time, mb / fprintf_time);
+  printf("formatter:  %.3fs (%.1f MB/s)\n", format_time, mb / format_time);
+  printf("format only: %.3fs (%.1f MB/s)\n", memory_time, mb / memory_time);
+  return 0;
+}
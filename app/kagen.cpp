@@ -10,10 +10,14 @@
 
 #include <mpi.h>
 
+#include <memory>
+#include <type_traits>
+
 #include "benchmark.h"
 #include "generator_config.h"
 #include "io/generator_io.h"
 #include "parse_parameters.h"
+#include "sampler.h"
 #include "timer.h"
 
 #include "geometric/delaunay/delaunay_2d.h"
@@ -77,10 +81,28 @@ void OutputParameters(PGeneratorConfig &config, const PEID /* rank */,
               << ", P=" << size << ")" << std::endl;
 }
 
+// Some generators additionally take the number of PEs
+template <typename Generator, typename EdgeCallback>
+std::unique_ptr<Generator> CreateGenerator(PGeneratorConfig &config,
+                                           const PEID rank, const PEID size,
+                                           const EdgeCallback &cb,
+                                           std::true_type) {
+  return std::unique_ptr<Generator>(new Generator(config, rank, size, cb));
+}
+
+template <typename Generator, typename EdgeCallback>
+std::unique_ptr<Generator> CreateGenerator(PGeneratorConfig &config,
+                                           const PEID rank, const PEID,
+                                           const EdgeCallback &cb,
+                                           std::false_type) {
+  return std::unique_ptr<Generator>(new Generator(config, rank, cb));
+}
+
 template <typename Generator, typename EdgeCallback>
 void RunGenerator(PGeneratorConfig &config, const PEID rank,
-                  const PEID /* size */, Statistics &stats, Statistics &edge_stats,
-                  Statistics &edges, const EdgeCallback &cb) {
+                  const PEID size, Statistics &stats, Statistics &edge_stats,
+                  Statistics &edges, Statistics &imbalance,
+                  const EdgeCallback &cb) {
   // Start timers
   Timer t;
   double local_time = 0.0;
@@ -88,8 +110,11 @@ void RunGenerator(PGeneratorConfig &config, const PEID rank,
   t.Restart();
 
   // Chunk distribution
-  Generator gen(config, rank, cb);
-  gen.Generate();
+  auto gen = CreateGenerator<Generator>(
+      config, rank, size, cb,
+      std::is_constructible<Generator, PGeneratorConfig &, const PEID,
+                            const PEID, const EdgeCallback &>());
+  gen->Generate();
 
   // Output
   local_time = t.Elapsed();
@@ -97,17 +122,84 @@ void RunGenerator(PGeneratorConfig &config, const PEID rank,
              MPI_COMM_WORLD);
   if (rank == ROOT) {
     stats.Push(total_time);
-    edge_stats.Push(total_time / gen.NumberOfEdges());
-    edges.Push(gen.NumberOfEdges());
+    edge_stats.Push(total_time / gen->NumberOfEdges());
+    edges.Push(gen->NumberOfEdges());
   }
 
+  // Imbalance of the stored edges (max / avg over all PEs)
+  SInt local_edges = gen->NumberOfEdges();
+  SInt max_edges = 0, sum_edges = 0;
+  MPI_Reduce(&local_edges, &max_edges, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+             ROOT, MPI_COMM_WORLD);
+  MPI_Reduce(&local_edges, &sum_edges, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+             ROOT, MPI_COMM_WORLD);
+  if (rank == ROOT && sum_edges > 0)
+    imbalance.Push((double)max_edges * size / sum_edges);
+
   if (rank == ROOT) std::cout << "write output..." << std::endl;
-  gen.Output();
+  gen->Output();
+}
+
+// Vertex IDs of all generators are below this bound
+SInt NumVertices(const PGeneratorConfig &config) {
+  if (config.generator == "grid_2d") return config.grid_x * config.grid_y;
+  if (config.generator == "grid_3d")
+    return config.grid_x * config.grid_y * config.grid_z;
+  return config.n;
+}
+
+template <typename Edge, typename EdgeCallback>
+void RunSelectedGenerator(PGeneratorConfig &config, const PEID rank,
+                          const PEID size, Statistics &stats,
+                          Statistics &edge_stats, Statistics &edges,
+                          Statistics &imbalance, const EdgeCallback &cb) {
+  if (config.generator == "gnm_directed")
+    RunGenerator<GNMDirected<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "gnm_undirected")
+    RunGenerator<GNMUndirected<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "gnp_directed")
+    RunGenerator<GNPDirected<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "gnp_undirected")
+    RunGenerator<GNPUndirected<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rgg_2d")
+    RunGenerator<RGG2D<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rgg_3d")
+    RunGenerator<RGG3D<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rdg_2d")
+    RunGenerator<Delaunay2D<EdgeCallback>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rdg_3d")
+    RunGenerator<Delaunay3D<EdgeCallback>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rhg")
+    RunGenerator<Hyperbolic<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "ba")
+    RunGenerator<Barabassi<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "rmat")
+    RunGenerator<Kronecker<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "grid_2d")
+    RunGenerator<Grid2D<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else if (config.generator == "grid_3d")
+    RunGenerator<Grid3D<EdgeCallback, Edge>, EdgeCallback>
+      (config, rank, size, stats, edge_stats, edges, imbalance, cb);
+  else 
+    if (rank == ROOT) std::cout << "generator not supported" << std::endl;
 }
 
 int main(int argn, char **argv) {
-  // Init MPI
-  MPI_Init(&argn, &argv);
+  // Init MPI (only the main thread communicates, see -threads)
+  int thread_support;
+  MPI_Init_thread(&argn, &argv, MPI_THREAD_FUNNELED, &thread_support);
   PEID rank, size;
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -118,65 +210,54 @@ int main(int argn, char **argv) {
 
   if (rank == ROOT) OutputParameters(generator_config, rank, size);
 
+  SInt num_vertices = NumVertices(generator_config);
+  if (generator_config.output_format == "binary32" &&
+      num_vertices >= ((SInt)1 << 32)) {
+    if (rank == ROOT)
+      std::cout << "binary32 output requires less than 2^32 vertices" << std::endl;
+    MPI_Finalize();
+    return 1;
+  }
+
   // Statistics
   Statistics stats;
   Statistics edge_stats;
   Statistics edges;
+  Statistics imbalance;
 
   auto edge_cb = [](SInt, SInt){};
   ULONG user_seed = generator_config.seed;
   for (ULONG i = 0; i < generator_config.iterations; ++i) {
     MPI_Barrier(MPI_COMM_WORLD);
     generator_config.seed = user_seed + i;
-    if (generator_config.generator == "gnm_directed")
-      RunGenerator<GNMDirected<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "gnm_undirected")
-      RunGenerator<GNMUndirected<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "gnp_directed")
-      RunGenerator<GNPDirected<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "gnp_undirected")
-      RunGenerator<GNPUndirected<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rgg_2d")
-      RunGenerator<RGG2D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rgg_3d")
-      RunGenerator<RGG3D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rdg_2d")
-      RunGenerator<Delaunay2D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rdg_3d")
-      RunGenerator<Delaunay3D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rhg")
-      RunGenerator<Hyperbolic<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "ba")
-      RunGenerator<Barabassi<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "rmat")
-      RunGenerator<Kronecker<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "grid_2d")
-      RunGenerator<Grid2D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else if (generator_config.generator == "grid_3d")
-      RunGenerator<Grid3D<decltype(edge_cb)>, decltype(edge_cb)>
-        (generator_config, rank, size, stats, edge_stats, edges, edge_cb);
-    else 
-      if (rank == ROOT) std::cout << "generator not supported" << std::endl;
+    // Store edges with the narrowest vertex IDs that fit
+    if (num_vertices < ((SInt)1 << 32))
+      RunSelectedGenerator<Edge32>(generator_config, rank, size, stats,
+                                   edge_stats, edges, imbalance, edge_cb);
+    else if (num_vertices <= ((SInt)1 << 48))
+      RunSelectedGenerator<PackedEdge48>(generator_config, rank, size, stats,
+                                         edge_stats, edges, imbalance, edge_cb);
+    else
+      RunSelectedGenerator<Edge64>(generator_config, rank, size, stats,
+                                   edge_stats, edges, imbalance, edge_cb);
   }
 
+  // Sampler allocations of all PEs and iterations
+  SInt local_sampler_stats[2] = {SamplerStats::Get().allocations.load(),
+                                 SamplerStats::Get().reuses.load()};
+  SInt sampler_stats[2] = {0, 0};
+  MPI_Reduce(local_sampler_stats, sampler_stats, 2, MPI_UNSIGNED_LONG_LONG,
+             MPI_SUM, ROOT, MPI_COMM_WORLD);
+
   if (rank == ROOT) {
     std::cout << "RESULT runner=" << generator_config.generator
               << " time=" << stats.Avg() << " stddev=" << stats.Stddev()
               << " iterations=" << generator_config.iterations
               << " edges=" << edges.Avg()
-              << " time_per_edge=" << edge_stats.Avg() << std::endl;
+              << " time_per_edge=" << edge_stats.Avg()
+              << " edge_imbalance=" << imbalance.Avg()
+              << " sampler_allocs=" << sampler_stats[0]
+              << " sampler_reuses=" << sampler_stats[1] << std::endl;
   }
 
   MPI_Finalize();
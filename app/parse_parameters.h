@@ -9,9 +9,11 @@
 #ifndef _PARSE_PARAMETERS_H_
 #define _PARSE_PARAMETERS_H_
 
+#include <mpi.h>
 #include <string.h>
 
 #include "generator_config.h"
+#include "io/output_format.h"
 #include "tools/arg_parser.h"
 
 #include "definitions.h"
@@ -19,7 +21,7 @@
 namespace kagen {
 
 inline void ParseParameters(int argn, char **argv,
-                     PEID, PEID size,
+                     PEID rank, PEID size,
                      PGeneratorConfig &generator_config) {
   ArgParser args(argn, argv);
 
@@ -34,6 +36,10 @@ inline void ParseParameters(int argn, char **argv,
       std::cout << "Usage:\t\t\tmpirun -n <num_proc> ./kagen -gen <generator> [additional parameters]" << std::endl;
       std::cout << "Generators:\t\tgnm_directed|gnm_undirected|gnp_directed|gnp_undirected|rgg_2d|rgg_3d|rdg_2d|rdg_3d|ba|rhg" << std::endl;
       std::cout << "Additional help:\t./kagen -gen <generator> -help" << std::endl;
+      std::cout << "Output:\t\t\t-format <format> [-single_file 0|1] [-omit_header] [-sort] [-redistribute] [-buffer_mb <mb>] [-direct_io]" << std::endl;
+      for (const auto &entry : OutputFormats())
+        std::cout << "\t\t\t  " << entry.name << "\t" << entry.description << std::endl;
+      std::cout << "Sampling:\t\t[-binom] [-skip] [-reuse_sampler]" << std::endl;
     }
     
     if (generator_config.generator == "gnm_undirected" || generator_config.generator == "gnm_directed") {
@@ -44,6 +50,7 @@ inline void ParseParameters(int argn, char **argv,
       std::cout << "-n\t\t<number of vertices as a power of two>" << std::endl;
       std::cout << "-m\t\t<number of edges as a power of two>" << std::endl;
       std::cout << "-k\t\t<number of chunks>" << std::endl;
+      std::cout << "-threads\t<threads per PE>" << std::endl;
       std::cout << "-seed\t\t<seed for PRNGs>" << std::endl;
       std::cout << "-output\t\t<output file>" << std::endl;
       std::cout << "-self_loops" << std::endl;
@@ -57,6 +64,7 @@ inline void ParseParameters(int argn, char **argv,
       std::cout << "-n\t\t<number of vertices as a power of two>" << std::endl;
       std::cout << "-p\t\t<edge probability>" << std::endl;
       std::cout << "-k\t\t<number of chunks>" << std::endl;
+      std::cout << "-threads\t<threads per PE>" << std::endl;
       std::cout << "-seed\t\t<seed for PRNGs>" << std::endl;
       std::cout << "-output\t\t<output file>" << std::endl;
       std::cout << "-self_loops" << std::endl;
@@ -69,6 +77,7 @@ inline void ParseParameters(int argn, char **argv,
       std::cout << "Parameters:" << std::endl;
       std::cout << "-n\t\t<number of vertices as a power of two>" << std::endl;
       std::cout << "-r\t\t<radius for vertices to be connected> (r <= 1.0)>" << std::endl;
+      std::cout << "-cell_split\t<cells per radius, 0 = automatic>" << std::endl;
       std::cout << "-k\t\t<number of chunks>" << std::endl;
       std::cout << "-seed\t\t<seed for PRNGs>" << std::endl;
       std::cout << "-output\t\t<output file>" << std::endl;
@@ -151,18 +160,44 @@ inline void ParseParameters(int argn, char **argv,
   else
     generator_config.n = (ULONG)1 << args.Get<ULONG>("n", 3);
 
-  // Blocks
-  generator_config.k = args.Get<ULONG>("k", size);
+  // Threads
+  generator_config.threads = std::max(args.Get<ULONG>("threads", 1), (ULONG)1);
+
+  // Blocks (Erdos-Renyi: enough for every thread to get one by default)
+  bool erdos_renyi = generator_config.generator.compare(0, 2, "gn") == 0;
+  generator_config.k = args.Get<ULONG>(
+      "k", erdos_renyi ? size * generator_config.threads : (ULONG)size);
 
   // RNG
   generator_config.seed = args.Get<ULONG>("seed", 1);
   generator_config.hash_sample = args.Get<bool>("hash_sample", false);
   generator_config.use_binom = args.IsSet("binom");
+  generator_config.reuse_sampler = args.IsSet("reuse_sampler");
+  generator_config.skip_sampling = args.IsSet("skip");
 
   // I/O
   generator_config.output_file = args.Get<std::string>("output", "out");
+  generator_config.output_format = args.Get<std::string>("format", "binary");
+  generator_config.single_file = args.Get<bool>("single_file", true);
+  generator_config.omit_header = args.IsSet("omit_header");
+  generator_config.sort_edges = args.IsSet("sort");
+  generator_config.redistribute = args.IsSet("redistribute");
+  OutputFormat format;
+  if (!ParseOutputFormat(generator_config.output_format, format)) {
+    if (rank == ROOT) {
+      std::cout << "unknown output format " << generator_config.output_format
+                << ", available formats:" << std::endl;
+      for (const auto &entry : OutputFormats())
+        std::cout << "  " << entry.name << "\t" << entry.description << std::endl;
+    }
+    // Every PE parses the same arguments
+    MPI_Finalize();
+    exit(1);
+  }
   generator_config.debug_output = args.Get<std::string>("debug", "dbg");
   generator_config.dist_size = args.Get<ULONG>("dist", 10);
+  generator_config.buffer_mb = args.Get<ULONG>("buffer_mb", 0);
+  generator_config.direct_io = args.IsSet("direct_io");
 
   // Edges
   bool exact_m = args.IsSet("exact_m");
@@ -175,6 +210,7 @@ inline void ParseParameters(int argn, char **argv,
 
   // Radius/Edges
   generator_config.r = args.Get<double>("r", 0.125);
+  generator_config.cell_split = args.Get<ULONG>("cell_split", 1);
 
   // Average degree
   generator_config.avg_degree = args.Get<double>("d", 5.0);
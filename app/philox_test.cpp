@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * app/philox_test.cpp
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "definitions.h"
+#include "rng_policy.h"
+
+using namespace kagen;
+
+// Known-answer test of Philox4x32-10 against the Random123 reference vectors
+// and of the batched Fill against the scalar stream
+// Usage: philox_test (returns non-zero on mismatch)
+int main() {
+  const uint32_t counter[3][4] = {
+      {0x00000000, 0x00000000, 0x00000000, 0x00000000},
+      {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+      {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}};
+  const uint32_t key[3][2] = {{0x00000000, 0x00000000},
+                              {0xffffffff, 0xffffffff},
+                              {0xa4093822, 0x299f31d0}};
+  const uint32_t expected[3][4] = {
+      {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8},
+      {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd},
+      {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+
+  int failures = 0;
+  for (int i = 0; i < 3; ++i) {
+    uint32_t out[4];
+    Philox4x32::Block(counter[i], key[i], out);
+    for (int j = 0; j < 4; ++j) {
+      if (out[j] == expected[i][j]) continue;
+      printf("vector %d word %d: got %08x, expected %08x\n", i, j, out[j],
+             expected[i][j]);
+      ++failures;
+    }
+  }
+
+  // Odd offset and length so that the scalar head and tail are exercised
+  const SInt count = 1000;
+  Philox4x32 scalar(26, 3), batched(26, 3);
+  scalar();
+  batched();
+  std::vector<uint64_t> filled(count);
+  batched.Fill(filled.data(), count);
+  for (SInt i = 0; i < count; ++i) {
+    if (filled[i] == scalar()) continue;
+    printf("Fill differs from operator() at %llu\n", i);
+    ++failures;
+    break;
+  }
+
+  printf("philox %s\n", failures == 0 ? "ok" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
@@ -25,6 +25,8 @@ typedef long double HPFloat;
 typedef double LPFloat;
 typedef ULONG SInt;
 typedef LONG SSInt;
+// 128 bit index spaces
+__extension__ typedef unsigned __int128 LInt;
 
 enum Direction {
   Up, Down, Left, Right, Front, Back
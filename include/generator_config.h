@@ -26,12 +26,27 @@ struct PGeneratorConfig {
   ULONG n, m;
   // Chunk size
   ULONG k;
+  // Threads per PE for chunk generation (edge callbacks are then called
+  // concurrently)
+  ULONG threads;
   // Edge probability
   double p;
   // Edge radius
   double r;
+  // RGG cells per radius (0 = choose from the expected vertices per cell)
+  ULONG cell_split;
   // Output filename
   std::string output_file;
+  // Output format (see io/output_format.h)
+  std::string output_format;
+  // Write a single file instead of one file per PE
+  bool single_file;
+  // Omit header in edge lists
+  bool omit_header;
+  // Sort and deduplicate edges globally before output
+  bool sort_edges;
+  // Send edges to the owner of their source vertex before output
+  bool redistribute;
   // Debug output
   std::string debug_output;
   // Use hash tryagain sampling
@@ -50,8 +65,16 @@ struct PGeneratorConfig {
   double min_degree;
   // Size of histogramm
   ULONG dist_size;
+  // Edge buffer size in MB before flushing to disk (0 = unbounded)
+  ULONG buffer_mb;
+  // Bypass page cache for per-PE output files
+  bool direct_io;
   // Use binomial approximation to hypergeometric
   bool use_binom;
+  // Sample with the persistent divide sampler also for the Mersenne Twister
+  bool reuse_sampler;
+  // Use geometric skip sampling for G(n,p)
+  bool skip_sampling;
   // Grid dimensions
   ULONG grid_x, grid_y, grid_z;
   // Use periodic boundary condition for grid generators
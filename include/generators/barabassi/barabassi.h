@@ -20,7 +20,7 @@
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class Barabassi {
  public:
   Barabassi(PGeneratorConfig &config, const PEID rank,
@@ -58,12 +58,8 @@ class Barabassi {
     }
   }
 
-  void Output() const {
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges();
-#else
-    io_.OutputDist();
-#endif
+  void Output() {
+    io_.Output(GetVertexRange());
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -78,7 +74,7 @@ class Barabassi {
   PEID rank_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_; 
 
   // Constants and variables
@@ -97,11 +93,7 @@ class Barabassi {
         } while (r % 2 == 1);
         SInt w = r / total_degree_;
         cb_(v, w);
-#ifdef OUTPUT_EDGES
         io_.PushEdge(v, w);
-#else
-        io_.UpdateDist(v);
-#endif
       }
     }
   };
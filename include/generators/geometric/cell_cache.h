@@ -0,0 +1,103 @@
+/*******************************************************************************
+ * include/generators/geometric/cell_cache.h
+ *
+ * Copyright (C) 2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _CELL_CACHE_H_
+#define _CELL_CACHE_H_
+
+#include <google/dense_hash_map>
+#include <vector>
+
+#include "definitions.h"
+#include "geometric_storage.h"
+
+namespace kagen {
+
+// Bounded cache for the vertices of cells of other PEs (halo cells)
+// Cells are evicted in insertion order, so a cell stays cached until
+// capacity further cells were inserted. Views returned by Find/Insert are
+// valid until the next call to Insert.
+template <SInt D>
+class CellCache {
+ public:
+  using CellView = typename GeometricStorage<D>::CellView;
+
+  CellCache() : next_(0), hits_(0), misses_(0), sorted_(false) {}
+
+  void Init(const SInt capacity, const SInt total_cells, const bool sorted) {
+    sorted_ = sorted;
+    slots_.assign(capacity, Slot());
+    next_ = 0;
+    index_.set_empty_key(total_cells);
+    index_.set_deleted_key(total_cells + 1);
+  }
+
+  bool Find(const SInt global_cell_id, CellView &view) {
+    auto it = index_.find(global_cell_id);
+    if (it == index_.end()) return false;
+    hits_++;
+    view = View(slots_[it->second]);
+    return true;
+  }
+
+  // Evicts the oldest cell, coordinates (and ids) are written to the view
+  CellView Insert(const SInt global_cell_id, const SInt n, const SInt offset,
+                  LPFloat *coords[D], SInt *&ids) {
+    misses_++;
+    Slot &slot = slots_[next_];
+    if (slot.id != NONE) index_.erase(slot.id);
+    index_[global_cell_id] = next_;
+    next_ = (next_ + 1) % slots_.size();
+
+    slot.id = global_cell_id;
+    slot.n = n;
+    slot.offset = offset;
+    for (SInt d = 0; d < D; ++d) {
+      slot.coords[d].resize(n);
+      coords[d] = slot.coords[d].data();
+    }
+    ids = nullptr;
+    if (sorted_) {
+      slot.ids.resize(n);
+      ids = slot.ids.data();
+    }
+    return View(slot);
+  }
+
+  SInt Hits() const { return hits_; }
+
+  SInt Misses() const { return misses_; }
+
+ private:
+  static constexpr SInt NONE = GeometricStorage<D>::NONE;
+
+  struct Slot {
+    Slot() : id(NONE), n(0), offset(0) {}
+
+    SInt id, n, offset;
+    std::vector<LPFloat> coords[D];
+    std::vector<SInt> ids;
+  };
+
+  std::vector<Slot> slots_;
+  google::dense_hash_map<SInt, SInt> index_;
+  SInt next_;
+  SInt hits_, misses_;
+  bool sorted_;
+
+  CellView View(const Slot &slot) const {
+    CellView view;
+    view.n = slot.n;
+    view.offset = slot.offset;
+    for (SInt d = 0; d < D; ++d) view.coords[d] = slot.coords[d].data();
+    view.ids = sorted_ ? slot.ids.data() : nullptr;
+    return view;
+  }
+};
+
+}
+#endif
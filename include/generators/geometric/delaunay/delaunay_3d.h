@@ -65,15 +65,11 @@ public:
     InitDatastructures();
   }
 
-  void Output() const override {
+  void Output() override {
 #ifdef DEL_STATS
     outputRadiusStats();
 #endif
-#ifdef OUTPUT_EDGES
-    edge_io_.OutputEdges();
-#else
-    edge_io_.OutputDist();
-#endif
+    edge_io_.Output(GetVertexRange());
     // point_io_.OutputEdges();
     // edge_io_.OutputEdges();
     // adjacency_io_.OutputEdges();
@@ -129,13 +125,16 @@ private:
 #endif
 
   SInt max_radius_;
+  // Vertices of the cell that is added to the triangulation
+  std::vector<Vertex> cell_vertices_;
   static constexpr SInt COPY_FLAG = SInt(1) << (sizeof(SInt) * CHAR_BIT - 1);
 
   void GenerateEdges(const SInt chunk_row, const SInt chunk_column,
                      const SInt chunk_depth) override {
     SInt chunk_id = Encode(chunk_column, chunk_row, chunk_depth);
-    SInt id_low = std::get<5>(chunks_[chunk_id]);
-    SInt id_high = id_low + std::get<0>(chunks_[chunk_id]);
+    const Chunk &chunk = storage_.GetChunk(chunk_id);
+    SInt id_low = chunk.offset;
+    SInt id_high = id_low + chunk.n;
     //            CGALCairoPainter basePainter;
 
     Dt_3d tria;
@@ -159,15 +158,15 @@ private:
         for (SInt cell_depth = 0; cell_depth < cells_per_dim_; ++cell_depth) {
           SInt cell_id = cell_row * cells_per_dim_ + cell_column +
                          (cells_per_dim_ * cells_per_dim_) * cell_depth;
-          SInt cellIdx = ComputeGlobalCellId(chunk_id, cell_id);
 
           //                    printf("[%llu] adding %lu points from own cell
           //                    %llu (%llu, %llu)\n",
-          //                           chunk_id, vertices_[cellIdx].size(),
+          //                           chunk_id, cell_vertices_.size(),
           //                           cell_id, cell_row, cell_column);
 
-        SortCellVertices(vertices_[cellIdx]);
-          for (const auto &v : vertices_[cellIdx]) {
+        GatherVertices(chunk_id, cell_id, cell_vertices_);
+        SortCellVertices(cell_vertices_);
+          for (const auto &v : cell_vertices_) {
             Point_3d p(std::get<0>(v), std::get<1>(v), std::get<2>(v));
             assert(bbChunk.xmin() <= p.x() && p.x() <= bbChunk.xmax());
             assert(bbChunk.ymin() <= p.y() && p.y() <= bbChunk.ymax());
@@ -323,8 +322,6 @@ private:
                       (cells_per_dim_ * cells_per_dim_) * neighbor_cell_dep;
 
                   // Check if vertices not generated
-                  SInt neighbor_cell_offset =
-                      ComputeGlobalCellId(neighbor_chunk_id, neighbor_cell_id);
                   // lazily generate vertices
                   GenerateVertices(neighbor_chunk_id, neighbor_cell_id);
 
@@ -334,7 +331,7 @@ private:
                   //                            cell %llu (%llu, %llu, %llu)
                   //                            with offset (%f,%f,%f)\n",
                   //                                   chunk_id,
-                  //                                   vertices_[neighbor_cell_offset].size(),
+                  //                                   cell_vertices_.size(),
                   //                                   neighbor_chunk_id,
                   //                                   neighbor_chunk_row,
                   //                                   neighbor_chunk_col,
@@ -346,8 +343,9 @@ private:
                   //                                   x_offset, y_offset,
                   //                                   z_offset);
 
-                  SortCellVertices(vertices_[neighbor_cell_offset]);
-                  for (const auto &v : vertices_[neighbor_cell_offset]) {
+                  GatherVertices(neighbor_chunk_id, neighbor_cell_id, cell_vertices_);
+                  SortCellVertices(cell_vertices_);
+                  for (const auto &v : cell_vertices_) {
                     Point_3d p(std::get<0>(v) + x_offset,
                                std::get<1>(v) + y_offset,
                                std::get<2>(v) + z_offset);
@@ -428,9 +426,7 @@ private:
     }
 
     // we have a conflict free triangulation, output edges
-#ifdef OUTPUT_EDGES
     edge_io_.ReserveEdges(id_high - id_low);
-#endif
     for (auto e = tria.finite_edges_begin(); e != tria.finite_edges_end();
          ++e) {
       // we only save outgoing edges from a vertices within our chunk
@@ -447,22 +443,18 @@ private:
         bool touches = false;
         if (!tria.is_infinite(v1) &&  !(v1->info() & COPY_FLAG)) {
             // v1 is in chunk we save the edge
-            edge_io_.UpdateDist(v1->info());
             touches = true;
         }
         if (!tria.is_infinite(v2) &&  !(v2->info() & COPY_FLAG)) {
             // v1 is not in chunk but v2 is in chunk we save the edge
-            edge_io_.UpdateDist(v2->info());
             touches = true;
         }
 
         if(touches){
             cb_((v1->info() & COPY_FLAG) ? v1->info() - COPY_FLAG : v1->info(), (v2->info() & COPY_FLAG) ? v2->info() - COPY_FLAG : v2->info());
             cb_((v2->info() & COPY_FLAG) ? v2->info() - COPY_FLAG : v2->info(), (v1->info() & COPY_FLAG) ? v1->info() - COPY_FLAG : v1->info());
-#ifdef OUTPUT_EDGES
             edge_io_.PushEdge((v1->info() & COPY_FLAG) ? v1->info() - COPY_FLAG : v1->info(), (v2->info() & COPY_FLAG) ? v2->info() - COPY_FLAG : v2->info());
             edge_io_.PushEdge((v2->info() & COPY_FLAG) ? v2->info() - COPY_FLAG : v2->info(), (v1->info() & COPY_FLAG) ? v1->info() - COPY_FLAG : v1->info());
-#endif
         }
     }
 
@@ -0,0 +1,87 @@
+/*******************************************************************************
+ * include/generators/geometric/distance_kernel.h
+ *
+ * Copyright (C) 2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _DISTANCE_KERNEL_H_
+#define _DISTANCE_KERNEL_H_
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Write the indices j in [begin, end) with squared distance between point
+// p and (coords[0][j], ..., coords[D - 1][j]) at most r2 to hits.
+// Returns the number of hits, hits needs room for end - begin indices.
+// All points are tested with the same instructions (also the tail), so the
+// test is symmetric for pairs that are tested on different PEs.
+template <SInt D>
+SInt DistanceKernel(const LPFloat *p, const LPFloat *const *coords,
+                    const SInt begin, const SInt end, const LPFloat r2,
+                    SInt *hits) {
+  SInt num_hits = 0;
+#if defined(__AVX512F__)
+  const __m512d radius = _mm512_set1_pd(r2);
+  const __m512i lanes = _mm512_set_epi64(7, 6, 5, 4, 3, 2, 1, 0);
+  __m512d point[D];
+  for (SInt d = 0; d < D; ++d) point[d] = _mm512_set1_pd(p[d]);
+
+  for (SInt j = begin; j < end; j += 8) {
+    __mmask8 valid = (end - j >= 8) ? 0xFF : (__mmask8)((1u << (end - j)) - 1);
+    __m512d dist = _mm512_setzero_pd();
+    for (SInt d = 0; d < D; ++d) {
+      __m512d diff = _mm512_sub_pd(
+          point[d], _mm512_maskz_loadu_pd(valid, coords[d] + j));
+      dist = _mm512_add_pd(dist, _mm512_mul_pd(diff, diff));
+    }
+    __mmask8 mask = _mm512_mask_cmp_pd_mask(valid, dist, radius, _CMP_LE_OQ);
+    __m512i ids = _mm512_add_epi64(lanes, _mm512_set1_epi64(j));
+    _mm512_mask_compressstoreu_epi64(hits + num_hits, mask, ids);
+    num_hits += __builtin_popcount(mask);
+  }
+#elif defined(__AVX2__)
+  const __m256d radius = _mm256_set1_pd(r2);
+  const __m256i lanes = _mm256_set_epi64x(3, 2, 1, 0);
+  __m256d point[D];
+  for (SInt d = 0; d < D; ++d) point[d] = _mm256_set1_pd(p[d]);
+
+  for (SInt j = begin; j < end; j += 4) {
+    SInt remaining = end - j;
+    __m256i valid = _mm256_cmpgt_epi64(_mm256_set1_epi64x(remaining), lanes);
+    __m256d dist = _mm256_setzero_pd();
+    for (SInt d = 0; d < D; ++d) {
+      __m256d diff =
+          _mm256_sub_pd(point[d], _mm256_maskload_pd(coords[d] + j, valid));
+      dist = _mm256_add_pd(dist, _mm256_mul_pd(diff, diff));
+    }
+    unsigned mask =
+        _mm256_movemask_pd(_mm256_cmp_pd(dist, radius, _CMP_LE_OQ)) &
+        _mm256_movemask_pd(_mm256_castsi256_pd(valid));
+    while (mask != 0) {
+      hits[num_hits++] = j + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+#else
+  for (SInt j = begin; j < end; ++j) {
+    LPFloat dist = 0;
+    for (SInt d = 0; d < D; ++d) {
+      LPFloat diff = p[d] - coords[d][j];
+      dist += diff * diff;
+    }
+    hits[num_hits] = j;
+    num_hits += (dist <= r2);
+  }
+#endif
+  return num_hits;
+}
+
+}
+#endif
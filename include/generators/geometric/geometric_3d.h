@@ -10,15 +10,16 @@
 #ifndef _GEOMETRIC_3D_H_
 #define _GEOMETRIC_3D_H_
 
-#include <google/dense_hash_map>
 #include <iostream>
 #include <tuple>
 #include <vector>
 
+#include "cell_cache.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
 #include "geometry.h"
+#include "geometric_storage.h"
 #include "libmorton/morton3D.h"
 #include "rng_wrapper.h"
 #include "hash.hpp"
@@ -27,10 +28,10 @@ namespace kagen {
 
 class Geometric3D {
  public:
-  // n, x_off, y_off, z_off, generated, offset
-  using Chunk = std::tuple<SInt, LPFloat, LPFloat, LPFloat, bool, SInt>;
-  // n, x_off, y_off, z_off, generated, offset
-  using Cell = std::tuple<SInt, LPFloat, LPFloat, LPFloat, bool, SInt>;
+  using Storage = GeometricStorage<3>;
+  using Chunk = Storage::Chunk;
+  using Cell = Storage::Cell;
+  using CellView = Storage::CellView;
   // x, y, z, id
   using Vertex = std::tuple<LPFloat, LPFloat, LPFloat, SInt>;
 
@@ -42,6 +43,7 @@ class Geometric3D {
     // Vertex range
     start_node_ = std::numeric_limits<SInt>::max();
     num_nodes_ = 0;
+    sorted_cells_ = false;
   }
 
   void Generate() {
@@ -58,7 +60,7 @@ class Geometric3D {
     return std::make_pair(start_node_, start_node_ + num_nodes_ - 1);
   }
 
-  virtual void Output() const = 0;
+  virtual void Output() = 0;
 
   virtual SInt NumberOfEdges() const = 0;
 
@@ -77,14 +79,13 @@ class Geometric3D {
   LPFloat cell_size_;
   SInt cells_per_chunk_, cells_per_dim_;
   SInt start_node_, num_nodes_;
+  // Sort the vertices of each cell by their first coordinate
+  bool sorted_cells_;
 
   // Data structures
-  // std::vector<Chunk> chunks_;
-  google::dense_hash_map<SInt, Chunk> chunks_;
-  // std::vector<Cell> cells_;
-  google::dense_hash_map<SInt, Cell> cells_;
-  // std::vector<std::vector<Vertex>> vertices_;
-  google::dense_hash_map<SInt, std::vector<Vertex>> vertices_;
+  Storage storage_;
+  // Point generation buffer
+  std::vector<LPFloat> uniforms_;
 
   virtual SInt computeNumberOfCells() const { return 1; };
 
@@ -98,12 +99,8 @@ class Geometric3D {
     local_chunk_end_ = local_chunk_start_ + local_chunks;
 
     // Init data structures
-    chunks_.set_empty_key(total_chunks_);
-    cells_.set_empty_key(total_chunks_ * cells_per_chunk_);
-    vertices_.set_empty_key(total_chunks_ * cells_per_chunk_);
-    // chunks_.resize(total_chunks_);
-    // cells_.resize(total_chunks_ * cells_per_chunk_);
-    // vertices_.resize(total_chunks_ * cells_per_chunk_);
+    storage_.Init(local_chunk_start_, local_chunk_end_, total_chunks_,
+                  cells_per_chunk_, sorted_cells_);
     // edge_file = fopen((config_.debug_output + std::to_string(rank_)).c_str(),
     // "w");
   }
@@ -118,7 +115,7 @@ class Geometric3D {
                     const SInt chunk_start_row, const SInt chunk_start_column,
                     const SInt chunk_start_depth, const SInt level, const SInt offset) {
     // Stop if chunk exists
-    if (chunks_.find(chunk_id) != end(chunks_)) return;
+    if (storage_.HasChunk(chunk_id)) return;
 
     // Stop if empty or already generated
     if (n <= 0 || n > config_.n) return;
@@ -131,9 +128,12 @@ class Geometric3D {
 
     // Base case
     if (row_k == 1 && column_k == 1 && depth_k == 1) {
-      chunks_[chunk_start] = std::make_tuple(
-          n, chunk_start_row * chunk_size_, chunk_start_column * chunk_size_,
-          chunk_start_depth * chunk_size_, false, offset);
+      Chunk &chunk = storage_.GetChunk(chunk_start);
+      chunk.n = n;
+      chunk.corner[0] = chunk_start_row * chunk_size_;
+      chunk.corner[1] = chunk_start_column * chunk_size_;
+      chunk.corner[2] = chunk_start_depth * chunk_size_;
+      chunk.offset = offset;
       if (IsLocalChunk(chunk_id)) {
         if (start_node_ > offset) start_node_ = offset;
         num_nodes_ += n;
@@ -237,18 +237,15 @@ class Geometric3D {
 
   virtual void GenerateCells(const SInt chunk_id) {
     // Lazily compute chunk
-    if (chunks_.find(chunk_id) == end(chunks_)) {
-      ComputeChunk(chunk_id);
-    }
-
-    auto &chunk = chunks_[chunk_id];
+    if (!storage_.HasChunk(chunk_id)) ComputeChunk(chunk_id);
+    Chunk &chunk = storage_.GetChunk(chunk_id);
 
     // Stop if cell distribution already generated
-    if (std::get<4>(chunk)) return;
+    if (chunk.generated) return;
 
     SInt seed = 0;
-    SInt n = std::get<0>(chunk);
-    SInt offset = std::get<5>(chunk);
+    SInt n = chunk.n;
+    SInt offset = chunk.offset;
     LPFloat total_area = chunk_size_ * chunk_size_ * chunk_size_;
     LPFloat cell_area = cell_size_ * cell_size_ * cell_size_;
 
@@ -257,108 +254,114 @@ class Geometric3D {
              total_chunks_ * cells_per_chunk_;
       SInt h = sampling::Spooky::hash(seed);
       SInt cell_vertices = rng_.GenerateBinomial(h, n, cell_area / total_area);
-      LPFloat cell_start_x =
-          std::get<1>(chunk) +
-          ((i / cells_per_dim_) % cells_per_dim_) * cell_size_;
-      LPFloat cell_start_y =
-          std::get<2>(chunk) + (i % cells_per_dim_) * cell_size_;
-      LPFloat cell_start_z =
-          std::get<3>(chunk) +
-          (i / (cells_per_dim_ * cells_per_dim_)) * cell_size_;
-
-      // Only store cells that are adjacent to local ones
-      if (cell_vertices != 0) {
-        cells_[ComputeGlobalCellId(chunk_id, i)] = std::make_tuple(
-            cell_vertices, cell_start_x, cell_start_y, cell_start_z, false, offset);
-      }
+      if (cell_vertices != 0)
+        storage_.InsertCell(chunk_id, i, MakeCell(chunk, i, cell_vertices, offset));
 
       // Update for multinomial
       n -= cell_vertices;
       offset += cell_vertices;
       total_area -= cell_area;
     }
-    std::get<4>(chunk) = true;
+    chunk.generated = true;
   }
 
-  void GenerateVertices(const SInt chunk_id, const SInt cell_id) {
-    // Lazily compute chunk
-    if (chunks_.find(chunk_id) == end(chunks_)) {
-      ComputeChunk(chunk_id);
-    }
-
-    auto &chunk = chunks_[chunk_id];
-
-    // Lazily compute cell distribution
-    if (!std::get<4>(chunk)) GenerateCells(chunk_id);
+  Cell MakeCell(const Chunk &chunk, const SInt cell_id, const SInt n,
+                const SInt offset) const {
+    Cell cell;
+    cell.n = n;
+    cell.corner[0] = chunk.corner[0] +
+                     ((cell_id / cells_per_dim_) % cells_per_dim_) * cell_size_;
+    cell.corner[1] = chunk.corner[1] + (cell_id % cells_per_dim_) * cell_size_;
+    cell.corner[2] = chunk.corner[2] +
+                     (cell_id / (cells_per_dim_ * cells_per_dim_)) * cell_size_;
+    cell.offset = offset;
+    cell.begin = Storage::NONE;
+    return cell;
+  }
 
-    // Stop if cell already generated
-    SInt global_cell_id = ComputeGlobalCellId(chunk_id, cell_id);
-    if (cells_.find(global_cell_id) == end(cells_)) return;
-    auto &cell = cells_[global_cell_id];
-    if (std::get<4>(cell)) return;
+  // Lazily compute chunk and cell distribution
+  Cell *FindCell(const SInt chunk_id, const SInt cell_id) {
+    if (!storage_.HasChunk(chunk_id)) ComputeChunk(chunk_id);
+    if (!storage_.GetChunk(chunk_id).generated) GenerateCells(chunk_id);
+    return storage_.FindCell(chunk_id, cell_id);
+  }
 
-    // Compute vertex distribution
-    SInt n = std::get<0>(cell);
-    SInt offset = std::get<5>(cell);
-    LPFloat start_x = std::get<1>(cell);
-    LPFloat start_y = std::get<2>(cell);
-    LPFloat start_z = std::get<3>(cell);
+  void GenerateVertices(const SInt chunk_id, const SInt cell_id) {
+    // Stop if cell empty or already generated
+    Cell *cell = FindCell(chunk_id, cell_id);
+    if (cell == nullptr || cell->begin != Storage::NONE) return;
 
+    LPFloat *coords[3];
+    SInt *ids;
+    storage_.AppendVertices(chunk_id, *cell, coords, ids);
     SInt seed = config_.seed + chunk_id * cells_per_chunk_ + cell_id;
-    SInt h = sampling::Spooky::hash(seed);
-    mersenne_.RandomInit(h);
-    std::vector<Vertex> &cell_vertices = vertices_[global_cell_id];
-    cell_vertices.reserve(n);
-    for (SInt i = 0; i < n; ++i) {
-      // Compute coordinates
-      LPFloat x = mersenne_.Random() * cell_size_ + start_x;
-      LPFloat y = mersenne_.Random() * cell_size_ + start_y;
-      LPFloat z = mersenne_.Random() * cell_size_ + start_z;
-
-      cell_vertices.emplace_back(x, y, z, offset + i);
-      // fprintf(edge_file, "v %f %f\n", x, y);
-    }
-    std::get<4>(cell) = true;
+    GeneratePoints(sampling::Spooky::hash(seed), *cell, coords[0], coords[1],
+                   coords[2]);
+    if (ids) storage_.SortVertices(cell->n, cell->offset, coords, ids);
   }
 
-  void GenerateVertices(const SInt chunk_id, const SInt cell_id,
-                        std::vector<Vertex> &vertex_buffer) {
-    // Lazily compute chunk
-    if (chunks_.find(chunk_id) == end(chunks_)) {
-      ComputeChunk(chunk_id);
+  // Vertices of a cell, cells of other PEs are generated into the cache
+  // instead of the storage
+  CellView GenerateVertices(const SInt chunk_id, const SInt cell_id,
+                            CellCache<3> &cache) {
+    if (IsLocalChunk(chunk_id)) {
+      GenerateVertices(chunk_id, cell_id);
+      return GetVertices(chunk_id, cell_id);
     }
 
-    const auto &chunk = chunks_[chunk_id];
+    CellView view = CellView();
+    SInt global_cell_id = ComputeGlobalCellId(chunk_id, cell_id);
+    if (cache.Find(global_cell_id, view)) return view;
+    const Cell *cell = FindCell(chunk_id, cell_id);
+    if (cell == nullptr) return view;
 
-    // Lazily compute cell distribution
-    if (!std::get<4>(chunk)) GenerateCells(chunk_id);
+    LPFloat *coords[3];
+    SInt *ids;
+    view = cache.Insert(global_cell_id, cell->n, cell->offset, coords, ids);
+    SInt seed = config_.seed + chunk_id * cells_per_chunk_ + cell_id;
+    GeneratePoints(sampling::Spooky::hash(seed), *cell, coords[0], coords[1],
+                   coords[2]);
+    if (ids) storage_.SortVertices(cell->n, cell->offset, coords, ids);
+    return view;
+  }
 
-    // Compute vertex distribution
-    SInt global_cell_id = ComputeGlobalCellId(chunk_id, cell_id);
-    if (cells_.find(global_cell_id) == end(cells_)) return;
-    const auto &cell = cells_[global_cell_id];
-    if (std::get<4>(cell)) return;
+  // Stored vertices of a cell (empty if not generated)
+  CellView GetVertices(const SInt chunk_id, const SInt cell_id) {
+    const Cell *cell = storage_.FindCell(chunk_id, cell_id);
+    if (cell == nullptr || cell->begin == Storage::NONE) return CellView();
+    return storage_.Vertices(chunk_id, *cell);
+  }
 
-    SInt n = std::get<0>(cell);
-    SInt offset = std::get<5>(cell);
-    LPFloat start_x = std::get<1>(cell);
-    LPFloat start_y = std::get<2>(cell);
-    LPFloat start_z = std::get<3>(cell);
+  // Copy the stored vertices of a cell into a vertex buffer
+  void GatherVertices(const SInt chunk_id, const SInt cell_id,
+                      std::vector<Vertex> &vertex_buffer) {
+    CellView view = GetVertices(chunk_id, cell_id);
+    vertex_buffer.clear();
+    vertex_buffer.reserve(view.n);
+    for (SInt i = 0; i < view.n; ++i)
+      vertex_buffer.emplace_back(view.coords[0][i], view.coords[1][i],
+                                 view.coords[2][i], view.Id(i));
+  }
 
-    SInt seed = config_.seed + chunk_id * cells_per_chunk_ + cell_id;
-    SInt h = sampling::Spooky::hash(seed);
+  // Write the points of a cell to x, y and z
+  // All uniforms of the cell are drawn in one batch (x, y and z alternating
+  // as before), scaling and offsetting is a separate vectorizable pass
+  void GeneratePoints(const SInt h, const Cell &cell, LPFloat *x, LPFloat *y,
+                      LPFloat *z) {
+    const SInt n = cell.n;
+    const LPFloat start_x = cell.corner[0];
+    const LPFloat start_y = cell.corner[1];
+    const LPFloat start_z = cell.corner[2];
     mersenne_.RandomInit(h);
-    vertex_buffer.clear();
-    vertex_buffer.reserve(n);
+    uniforms_.resize(3 * n);
+    mersenne_.Fill(uniforms_.data(), 3 * n);
+
+    const LPFloat *u = uniforms_.data();
+    const LPFloat size = cell_size_;
     for (SInt i = 0; i < n; ++i) {
-      // Compute coordinates
-      LPFloat x = mersenne_.Random() * cell_size_ + start_x;
-      LPFloat y = mersenne_.Random() * cell_size_ + start_y;
-      LPFloat z = mersenne_.Random() * cell_size_ + start_z;
-
-      // vertex_buffer.emplace_back(x, y, z);
-      vertex_buffer[i] = std::make_tuple(x, y, z, offset + i);
-      // fprintf(edge_file, "v %f %f\n", x, y);
+      x[i] = u[3 * i] * size + start_x;
+      y[i] = u[3 * i + 1] * size + start_y;
+      z[i] = u[3 * i + 2] * size + start_z;
     }
   }
 
@@ -0,0 +1,217 @@
+/*******************************************************************************
+ * include/generators/geometric/geometric_storage.h
+ *
+ * Copyright (C) 2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _GEOMETRIC_STORAGE_H_
+#define _GEOMETRIC_STORAGE_H_
+
+#include <algorithm>
+#include <deque>
+#include <google/dense_hash_map>
+#include <limits>
+#include <vector>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Flat storage of the chunks, cells and vertices of the geometric generators
+// Local chunks and their cells are indexed directly, chunks of other PEs
+// (halo) get a slot on first use and keep only the cells that are inserted.
+// The vertices of a chunk live in one arena with one coordinate array per
+// dimension, vertex ids are implicit (offset of the cell + index) unless
+// the vertices of each cell are sorted, then the ids are stored as well.
+template <SInt D>
+class GeometricStorage {
+ public:
+  static constexpr SInt NONE = std::numeric_limits<SInt>::max();
+
+  struct Chunk {
+    SInt n;
+    LPFloat corner[D];
+    SInt offset;
+    // Cell distribution computed
+    bool generated;
+  };
+
+  struct Cell {
+    SInt n;
+    LPFloat corner[D];
+    SInt offset;
+    // First vertex in the arena of the chunk (NONE if not generated)
+    SInt begin;
+  };
+
+  // Vertices of a cell
+  struct CellView {
+    SInt n;
+    SInt offset;
+    const LPFloat *coords[D];
+    // nullptr if ids are implicit
+    const SInt *ids;
+
+    inline SInt Id(const SInt i) const { return ids ? ids[i] : offset + i; }
+  };
+
+  void Init(const SInt local_chunk_start, const SInt local_chunk_end,
+            const SInt total_chunks, const SInt cells_per_chunk,
+            const bool sorted) {
+    local_chunk_start_ = local_chunk_start;
+    cells_per_chunk_ = cells_per_chunk;
+    sorted_ = sorted;
+    local_chunks_ = local_chunk_end - local_chunk_start;
+
+    slots_.assign(local_chunks_, Slot());
+    halo_slots_.set_empty_key(total_chunks);
+    halo_cells_.set_empty_key(total_chunks * cells_per_chunk);
+    local_cells_.clear();
+    local_cells_.reserve(local_chunks_ * cells_per_chunk);
+  }
+
+  bool HasChunk(const SInt chunk_id) const {
+    SInt slot = FindSlot(chunk_id);
+    return slot != NONE && slots_[slot].present;
+  }
+
+  // Inserts an empty chunk if it does not exist
+  Chunk &GetChunk(const SInt chunk_id) {
+    Slot &slot = slots_[GetSlot(chunk_id)];
+    slot.present = true;
+    return slot.chunk;
+  }
+
+  void InsertCell(const SInt chunk_id, const SInt cell_id, const Cell &cell) {
+    Slot &slot = slots_[GetSlot(chunk_id)];
+    if (IsLocal(chunk_id)) {
+      if (slot.cells == NONE) {
+        slot.cells = local_cells_.size();
+        local_cells_.resize(local_cells_.size() + cells_per_chunk_, EmptyCell());
+      }
+      local_cells_[slot.cells + cell_id] = cell;
+    } else {
+      halo_cells_[chunk_id * cells_per_chunk_ + cell_id] = cell;
+    }
+  }
+
+  // nullptr for empty cells and cells that were not inserted
+  Cell *FindCell(const SInt chunk_id, const SInt cell_id) {
+    if (IsLocal(chunk_id)) {
+      SInt cells = slots_[chunk_id - local_chunk_start_].cells;
+      if (cells == NONE) return nullptr;
+      Cell &cell = local_cells_[cells + cell_id];
+      return cell.n > 0 ? &cell : nullptr;
+    }
+    auto it = halo_cells_.find(chunk_id * cells_per_chunk_ + cell_id);
+    return it == halo_cells_.end() ? nullptr : &it->second;
+  }
+
+  bool Sorted() const { return sorted_; }
+
+  // Append n vertices of a cell to the arena of its chunk
+  // Returns the coordinate (and id) arrays to write them to, they stay valid
+  // until the next call for the same chunk
+  void AppendVertices(const SInt chunk_id, Cell &cell, LPFloat *coords[D],
+                      SInt *&ids) {
+    Slot &slot = slots_[GetSlot(chunk_id)];
+    cell.begin = slot.arena[0].size();
+    // All cells of local chunks are generated
+    bool reserve = IsLocal(chunk_id) && cell.begin == 0;
+    for (SInt d = 0; d < D; ++d) {
+      if (reserve) slot.arena[d].reserve(slot.chunk.n);
+      slot.arena[d].resize(cell.begin + cell.n);
+      coords[d] = slot.arena[d].data() + cell.begin;
+    }
+    ids = nullptr;
+    if (sorted_) {
+      if (reserve) slot.ids.reserve(slot.chunk.n);
+      slot.ids.resize(cell.begin + cell.n);
+      ids = slot.ids.data() + cell.begin;
+    }
+  }
+
+  // Sort the n vertices of a cell by their first coordinate (ties by id)
+  // and write their ids
+  void SortVertices(const SInt n, const SInt offset, LPFloat *const coords[D],
+                    SInt *ids) {
+    order_.resize(n);
+    for (SInt i = 0; i < n; ++i) order_[i] = i;
+    const LPFloat *x = coords[0];
+    std::sort(order_.begin(), order_.end(), [x](const SInt a, const SInt b) {
+      return x[a] < x[b] || (x[a] == x[b] && a < b);
+    });
+
+    scratch_.resize(n);
+    for (SInt d = 0; d < D; ++d) {
+      for (SInt i = 0; i < n; ++i) scratch_[i] = coords[d][order_[i]];
+      std::copy(scratch_.begin(), scratch_.end(), coords[d]);
+    }
+    for (SInt i = 0; i < n; ++i) ids[i] = offset + order_[i];
+  }
+
+  CellView Vertices(const SInt chunk_id, const Cell &cell) const {
+    const Slot &slot = slots_[FindSlot(chunk_id)];
+    CellView view;
+    view.n = cell.n;
+    view.offset = cell.offset;
+    for (SInt d = 0; d < D; ++d)
+      view.coords[d] = slot.arena[d].data() + cell.begin;
+    view.ids = sorted_ ? slot.ids.data() + cell.begin : nullptr;
+    return view;
+  }
+
+ private:
+  struct Slot {
+    Slot() : present(false), cells(NONE) { chunk = Chunk(); }
+
+    bool present;
+    Chunk chunk;
+    // First cell descriptor of local chunks
+    SInt cells;
+    std::vector<LPFloat> arena[D];
+    std::vector<SInt> ids;
+  };
+
+  SInt local_chunk_start_, local_chunks_, cells_per_chunk_;
+  bool sorted_;
+  // Local chunks first, then halo chunks in order of first use
+  // (deque keeps references to chunks valid while halo chunks are added)
+  std::deque<Slot> slots_;
+  google::dense_hash_map<SInt, SInt> halo_slots_;
+  std::vector<Cell> local_cells_;
+  google::dense_hash_map<SInt, Cell> halo_cells_;
+  // Sorting buffers
+  std::vector<SInt> order_;
+  std::vector<LPFloat> scratch_;
+
+  static Cell EmptyCell() {
+    Cell cell = Cell();
+    cell.begin = NONE;
+    return cell;
+  }
+
+  inline bool IsLocal(const SInt chunk_id) const {
+    return chunk_id - local_chunk_start_ < local_chunks_;
+  }
+
+  SInt FindSlot(const SInt chunk_id) const {
+    if (IsLocal(chunk_id)) return chunk_id - local_chunk_start_;
+    auto it = halo_slots_.find(chunk_id);
+    return it == halo_slots_.end() ? NONE : it->second;
+  }
+
+  SInt GetSlot(const SInt chunk_id) {
+    SInt slot = FindSlot(chunk_id);
+    if (slot != NONE) return slot;
+    slot = slots_.size();
+    halo_slots_[chunk_id] = slot;
+    slots_.emplace_back();
+    return slot;
+  }
+};
+
+}
+#endif
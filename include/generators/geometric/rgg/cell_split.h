@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * include/generators/geometric/rgg/cell_split.h
+ *
+ * Copyright (C) 2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _CELL_SPLIT_H_
+#define _CELL_SPLIT_H_
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "definitions.h"
+#include "generator_config.h"
+
+namespace kagen {
+
+// Expected vertices per cell the automatic split keeps at least (below
+// that the work per cell pair outweighs the saved distance tests)
+constexpr LPFloat MIN_CELL_VERTICES = 50;
+constexpr SInt MAX_CELL_SPLIT = 4;
+
+// Number of cells per radius for an RGG in dim dimensions
+// The configured split is used unless it is 0, then the split is the
+// largest one whose cells of side r / split hold MIN_CELL_VERTICES vertices
+// in expectation.
+inline SInt CellSplit(const PGeneratorConfig &config, const SInt dim) {
+  if (config.cell_split > 0) return config.cell_split;
+  LPFloat split = config.r * std::pow(config.n / MIN_CELL_VERTICES, 1.0 / dim);
+  return std::min(std::max((SInt)split, (SInt)1), MAX_CELL_SPLIT);
+}
+
+// Number of cells per chunk and dimension for cells of side at least
+// r / split. The neighborhood of a cell reaches split cells in each
+// direction and has to stay within the adjacent chunks, so chunks of side
+// below r are rejected and rounding never leaves fewer than split cells.
+inline SInt CellsPerDim(const PGeneratorConfig &config, const PEID rank,
+                        const LPFloat chunk_size, const SInt split) {
+  if (chunk_size < config.r) {
+    if (rank == ROOT)
+      std::cout << "radius " << config.r << " exceeds the chunk size "
+                << chunk_size << ", use fewer chunks (-k)" << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  return std::max((SInt)floor(chunk_size / (config.r / split)), split);
+}
+
+}
+#endif
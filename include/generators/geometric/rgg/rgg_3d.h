@@ -10,11 +10,13 @@
 #ifndef _RGG_3D_H_
 #define _RGG_3D_H_
 
+#include "cell_split.h"
+#include "geometric/distance_kernel.h"
 #include "geometric/geometric_3d.h"
 
 namespace kagen {
 
-template <typename EdgeCallback>
+template <typename EdgeCallback, typename Edge = Edge64>
 class RGG3D : public Geometric3D {
  public:
   RGG3D(PGeneratorConfig &config, const PEID rank,
@@ -25,33 +27,58 @@ class RGG3D : public Geometric3D {
     chunks_per_dim_ = cbrt(config_.k);
     chunk_size_ = 1.0 / chunks_per_dim_;
 
-    // Cell variables
-    cells_per_dim_ = floor(chunk_size_ / config_.r);
+    // Cell variables (cells of side at least r / split)
+    split_ = CellSplit(config_, 3);
+    LPFloat cell_r = config_.r / split_;
+    cells_per_dim_ = CellsPerDim(config_, rank_, chunk_size_, split_);
     cells_per_chunk_ = cells_per_dim_ * cells_per_dim_ * cells_per_dim_;
     cell_size_ =
-        config_.r + (chunk_size_ - cells_per_dim_ * config_.r) / cells_per_dim_;
+        cell_r + (chunk_size_ - cells_per_dim_ * cell_r) / cells_per_dim_;
     target_r_ = config_.r * config_.r;
-
+    // Slightly larger than r, so rounding never prunes a pair within r
+    sweep_r_ = config_.r * (1 + 1e-12);
+
+    // Neighbor cells within split_ cells that may contain vertices within r
+    SSInt s = split_;
+    for (SSInt i = -s; i <= s; i++)
+      for (SSInt j = -s; j <= s; j++)
+        for (SSInt k = -s; k <= s; k++)
+          if (CellGap(i) * CellGap(i) + CellGap(j) * CellGap(j) +
+                  CellGap(k) * CellGap(k) <=
+              sweep_r_ * sweep_r_)
+            stencil_.emplace_back(i, j, k);
+
+    sorted_cells_ = true;
     InitDatastructures();
+    // Halo cells of 3 * split_ consecutive cell slices (and split_ ahead)
+    SInt slice = cells_per_dim_ + 2 * split_;
+    halo_cache_.Init(4 * split_ * slice * slice,
+                     total_chunks_ * cells_per_chunk_, true);
   }
 
-  void Output() const override { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
+  void Output() override { 
+#ifdef RGG_STATS
+    std::cout << "[" << rank_ << "] halo cells: " << halo_cache_.Hits()
+              << " hits, " << halo_cache_.Misses() << " misses" << std::endl;
 #endif
+    io_.Output(GetVertexRange());
   }
 
   SInt NumberOfEdges() const override { return io_.NumEdges(); }
 
  public:
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_;
   // FILE* edge_file;
 
-  LPFloat target_r_;
+  LPFloat target_r_, sweep_r_;
+  SInt split_;
+  // Offsets (row, column, depth) of the neighbor cells
+  std::vector<std::tuple<SSInt, SSInt, SSInt>> stencil_;
+  CellCache<3> halo_cache_;
+  // Neighbors of the current vertex
+  std::vector<SInt> hits_;
 
   void GenerateEdges(const SInt chunk_row, const SInt chunk_column,
                      const SInt chunk_depth) override {
@@ -60,72 +87,68 @@ class RGG3D : public Geometric3D {
       for (SInt cell_column = 0; cell_column < cells_per_dim_; ++cell_column) {
         for (SInt cell_depth = 0; cell_depth < cells_per_dim_; ++cell_depth) {
           // Iterate neighboring cells
-          for (SSInt i = -1; i <= 1; i++) {
-            SSInt neighbor_row = cell_row + i;
-            for (SSInt j = -1; j <= 1; j++) {
-              SSInt neighbor_column = cell_column + j;
-              for (SSInt k = -1; k <= 1; k++) {
-                SSInt neighbor_depth = cell_depth + k;
-
-                // Compute diffs
-                int horizontal_diff = 0;
-                int vertical_diff = 0;
-                int depth_diff = 0;
-                if (neighbor_depth < 0)
-                  depth_diff = -1;
-                else if (neighbor_depth >= (SSInt)cells_per_dim_)
-                  depth_diff = 1;
-                if (neighbor_column < 0)
-                  horizontal_diff = -1;
-                else if (neighbor_column >= (SSInt)cells_per_dim_)
-                  horizontal_diff = 1;
-                if (neighbor_row < 0)
-                  vertical_diff = -1;
-                else if (neighbor_row >= (SSInt)cells_per_dim_)
-                  vertical_diff = 1;
-
-                // Get correct grid cells
-                SInt neighbor_cell_row =
-                    (neighbor_row % (SSInt)cells_per_dim_ + cells_per_dim_) %
-                    cells_per_dim_;
-                SInt neighbor_cell_column =
-                    (neighbor_column % (SSInt)cells_per_dim_ + cells_per_dim_) %
-                    cells_per_dim_;
-                SInt neighbor_cell_depth =
-                    (neighbor_depth % (SSInt)cells_per_dim_ + cells_per_dim_) %
-                    cells_per_dim_;
-
-                // Skip invalid cells
-                if ((SSInt)chunk_row + vertical_diff < 0 ||
-                    chunk_row + vertical_diff >= chunks_per_dim_ ||
-                    (SSInt)chunk_column + horizontal_diff < 0 ||
-                    chunk_column + horizontal_diff >= chunks_per_dim_ ||
-                    (SSInt)chunk_depth + depth_diff < 0 ||
-                    chunk_depth + depth_diff >= chunks_per_dim_)
-                  continue;
-
-                // Get grid buckets for each cell
-                SInt chunk_id = Encode(chunk_column, chunk_row, chunk_depth);
-                SInt cell_id = cell_row * cells_per_dim_ + cell_column +
-                               (cells_per_dim_ * cells_per_dim_) * cell_depth;
-                SInt neighbor_id =
-                    Encode(chunk_column + horizontal_diff,
-                           chunk_row + vertical_diff, chunk_depth + depth_diff);
-                SInt neighbor_cell_id =
-                    neighbor_cell_row * cells_per_dim_ + neighbor_cell_column +
-                    (cells_per_dim_ * cells_per_dim_) * neighbor_cell_depth;
-
-                // If neighbor is local chunk skip
-                if (chunk_id > neighbor_id && IsLocalChunk(neighbor_id))
-                  continue;
-                // Skip grid cells with lower id
-                if (chunk_id == neighbor_id && cell_id > neighbor_cell_id)
-                  continue;
-
-                GenerateGridEdges(chunk_id, cell_id, neighbor_id,
-                                  neighbor_cell_id);
-              }
-            }
+          for (const auto &offset : stencil_) {
+            SSInt neighbor_row = cell_row + std::get<0>(offset);
+            SSInt neighbor_column = cell_column + std::get<1>(offset);
+            SSInt neighbor_depth = cell_depth + std::get<2>(offset);
+
+            // Compute diffs
+            int horizontal_diff = 0;
+            int vertical_diff = 0;
+            int depth_diff = 0;
+            if (neighbor_depth < 0)
+              depth_diff = -1;
+            else if (neighbor_depth >= (SSInt)cells_per_dim_)
+              depth_diff = 1;
+            if (neighbor_column < 0)
+              horizontal_diff = -1;
+            else if (neighbor_column >= (SSInt)cells_per_dim_)
+              horizontal_diff = 1;
+            if (neighbor_row < 0)
+              vertical_diff = -1;
+            else if (neighbor_row >= (SSInt)cells_per_dim_)
+              vertical_diff = 1;
+
+            // Get correct grid cells
+            SInt neighbor_cell_row =
+                (neighbor_row % (SSInt)cells_per_dim_ + cells_per_dim_) %
+                cells_per_dim_;
+            SInt neighbor_cell_column =
+                (neighbor_column % (SSInt)cells_per_dim_ + cells_per_dim_) %
+                cells_per_dim_;
+            SInt neighbor_cell_depth =
+                (neighbor_depth % (SSInt)cells_per_dim_ + cells_per_dim_) %
+                cells_per_dim_;
+
+            // Skip invalid cells
+            if ((SSInt)chunk_row + vertical_diff < 0 ||
+                chunk_row + vertical_diff >= chunks_per_dim_ ||
+                (SSInt)chunk_column + horizontal_diff < 0 ||
+                chunk_column + horizontal_diff >= chunks_per_dim_ ||
+                (SSInt)chunk_depth + depth_diff < 0 ||
+                chunk_depth + depth_diff >= chunks_per_dim_)
+              continue;
+
+            // Get grid buckets for each cell
+            SInt chunk_id = Encode(chunk_column, chunk_row, chunk_depth);
+            SInt cell_id = cell_row * cells_per_dim_ + cell_column +
+                           (cells_per_dim_ * cells_per_dim_) * cell_depth;
+            SInt neighbor_id =
+                Encode(chunk_column + horizontal_diff,
+                       chunk_row + vertical_diff, chunk_depth + depth_diff);
+            SInt neighbor_cell_id =
+                neighbor_cell_row * cells_per_dim_ + neighbor_cell_column +
+                (cells_per_dim_ * cells_per_dim_) * neighbor_cell_depth;
+
+            // If neighbor is local chunk skip
+            if (chunk_id > neighbor_id && IsLocalChunk(neighbor_id))
+              continue;
+            // Skip grid cells with lower id
+            if (chunk_id == neighbor_id && cell_id > neighbor_cell_id)
+              continue;
+
+            GenerateGridEdges(chunk_id, cell_id, neighbor_id,
+                              neighbor_cell_id);
           }
         }
       }
@@ -135,90 +158,55 @@ class RGG3D : public Geometric3D {
   void GenerateGridEdges(const SInt first_chunk_id, const SInt first_cell_id,
                          const SInt second_chunk_id,
                          const SInt second_cell_id) {
-    // Check if vertices not generated
-    SInt first_global_cell_id = ComputeGlobalCellId(first_chunk_id, first_cell_id);
-    SInt second_global_cell_id =
-        ComputeGlobalCellId(second_chunk_id, second_cell_id);
-    GenerateVertices(first_chunk_id, first_cell_id);
-    GenerateVertices(second_chunk_id, second_cell_id);
-
-    // Gather vertices
-    if (vertices_.find(first_global_cell_id) == end(vertices_)) return;
-    if (vertices_.find(second_global_cell_id) == end(vertices_)) return;
-    const std::vector<Vertex> &vertices_first = vertices_[first_global_cell_id];
-    const std::vector<Vertex> &vertices_second = vertices_[second_global_cell_id];
-    // GenerateVertices(first_chunk_id, first_cell_id, first_vertex_buffer_);
-    // GenerateVertices(second_chunk_id, second_cell_id, second_vertex_buffer_);
-    // const std::vector<Vertex> &vertices_first = first_vertex_buffer_;
-    // const std::vector<Vertex> &vertices_second = second_vertex_buffer_;
+    // Gather vertices (first cell is local)
+    bool same_cell =
+        first_chunk_id == second_chunk_id && first_cell_id == second_cell_id;
+    CellView second =
+        GenerateVertices(second_chunk_id, second_cell_id, halo_cache_);
+    if (second.n == 0) return;
+    CellView first = GetVertices(first_chunk_id, first_cell_id);
+    if (first.n == 0) return;
+
+    const LPFloat *x1 = first.coords[0], *x2 = second.coords[0];
+    bool push_reverse = same_cell || IsLocalChunk(second_chunk_id);
+    hits_.resize(second.n);
+
     // Generate edges
-    // Same cell
-    if (first_chunk_id == second_chunk_id && first_cell_id == second_cell_id) {
-      for (SInt i = 0; i < vertices_first.size(); ++i) {
-        const Vertex &v1 = vertices_first[i];
-        for (SInt j = i + 1; ++j < vertices_second.size();) {
-          const Vertex &v2 = vertices_second[j];
-          // Euclidean distance
-          LPFloat x = std::get<0>(v1) - std::get<0>(v2);
-          LPFloat y = std::get<1>(v1) - std::get<1>(v2);
-          LPFloat z = std::get<2>(v1) - std::get<2>(v2);
-          if (x * x + y * y + z * z <= target_r_) {
-            cb_(std::get<3>(v1), std::get<3>(v2));
-            cb_(std::get<3>(v2), std::get<3>(v1));
-#ifdef OUTPUT_EDGES
-            io_.PushEdge(std::get<3>(v1), std::get<3>(v2));
-            io_.PushEdge(std::get<3>(v2), std::get<3>(v1));
-#else
-            io_.UpdateDist(std::get<3>(v1));
-            io_.UpdateDist(std::get<3>(v2));
-#endif
-            // fprintf(edge_file, "e %f %f %f %f %f %f\n", std::get<0>(v1),
-            // std::get<1>(v1), std::get<2>(v1), std::get<0>(v2),
-            // std::get<1>(v2), std::get<2>(v2));
-          }
-        }
-      }
-    } else {
-      for (SInt i = 0; i < vertices_first.size(); ++i) {
-        const Vertex &v1 = vertices_first[i];
-        for (SInt j = 0; j < vertices_second.size(); ++j) {
-          const Vertex &v2 = vertices_second[j];
-          LPFloat x = std::get<0>(v1) - std::get<0>(v2);
-          LPFloat y = std::get<1>(v1) - std::get<1>(v2);
-          LPFloat z = std::get<2>(v1) - std::get<2>(v2);
-          if (x * x + y * y + z * z <= target_r_) {
-            cb_(std::get<3>(v1), std::get<3>(v2));
-            cb_(std::get<3>(v2), std::get<3>(v1));
-#ifdef OUTPUT_EDGES
-            io_.PushEdge(std::get<3>(v1), std::get<3>(v2));
-            if (IsLocalChunk(second_chunk_id)) io_.PushEdge(std::get<3>(v2), std::get<3>(v1));
-#else
-            io_.UpdateDist(std::get<3>(v1));
-            io_.UpdateDist(std::get<3>(v2));
-#endif
-            // fprintf(edge_file, "e %f %f %f %f %f %f\n", std::get<0>(v1),
-            // std::get<1>(v1), std::get<2>(v1), std::get<0>(v2),
-            // std::get<1>(v2), std::get<2>(v2));
-          }
-        }
+    // Both cells are sorted by x, only the window of second with
+    // |x1 - x2| <= r is tested exactly
+    SInt low = 0, high = 0;
+    for (SInt i = 0; i < first.n; ++i) {
+      while (low < second.n && x1[i] - x2[low] > sweep_r_) ++low;
+      while (high < second.n && x2[high] - x1[i] <= sweep_r_) ++high;
+
+      LPFloat p[3] = {x1[i], first.coords[1][i], first.coords[2][i]};
+      // Same cell
+      SInt begin = same_cell ? i + 1 : low;
+      SInt num_hits = 0;
+      if (begin < high)
+        num_hits = DistanceKernel<3>(p, second.coords, begin, high, target_r_,
+                                     hits_.data());
+      for (SInt h = 0; h < num_hits; ++h) {
+        SInt u = first.Id(i), v = second.Id(hits_[h]);
+        cb_(u, v);
+        cb_(v, u);
+        io_.PushEdge(u, v);
+        if (push_reverse) io_.PushEdge(v, u);
       }
     }
   }
 
   void GenerateCells(const SInt chunk_id) override {
     // Lazily compute chunk
-    if (chunks_.find(chunk_id) == end(chunks_)) {
-      ComputeChunk(chunk_id);
-    }
-
-    auto &chunk = chunks_[chunk_id];
+    if (!storage_.HasChunk(chunk_id)) ComputeChunk(chunk_id);
+    Chunk &chunk = storage_.GetChunk(chunk_id);
 
     // Stop if cell distribution already generated
-    if (std::get<4>(chunk)) return;
+    if (chunk.generated) return;
 
     SInt seed = 0;
-    SInt n = std::get<0>(chunk);
-    SInt offset = std::get<5>(chunk);
+    SInt n = chunk.n;
+    SInt offset = chunk.offset;
     LPFloat total_area = chunk_size_ * chunk_size_ * chunk_size_;
     LPFloat cell_area = cell_size_ * cell_size_ * cell_size_;
 
@@ -227,21 +215,12 @@ class RGG3D : public Geometric3D {
              total_chunks_ * cells_per_chunk_;
       SInt h = sampling::Spooky::hash(seed);
       SInt cell_vertices = rng_.GenerateBinomial(h, n, cell_area / total_area);
-      LPFloat cell_start_x =
-          std::get<1>(chunk) +
-          ((i / cells_per_dim_) % cells_per_dim_) * cell_size_;
-      LPFloat cell_start_y =
-          std::get<2>(chunk) + (i % cells_per_dim_) * cell_size_;
-      LPFloat cell_start_z =
-          std::get<3>(chunk) +
-          (i / (cells_per_dim_ * cells_per_dim_)) * cell_size_;
 
       // Only store cells that are adjacent to local ones
       if (cell_vertices != 0) {
-        if (IsLocalChunk(chunk_id) || IsAdjacentCell(chunk_id, i)) {
-          cells_[ComputeGlobalCellId(chunk_id, i)] = std::make_tuple(
-              cell_vertices, cell_start_x, cell_start_y, cell_start_z, false, offset);
-        }
+        if (IsLocalChunk(chunk_id) || IsAdjacentCell(chunk_id, i))
+          storage_.InsertCell(chunk_id, i,
+                              MakeCell(chunk, i, cell_vertices, offset));
       }
 
       // Update for multinomial
@@ -249,7 +228,7 @@ class RGG3D : public Geometric3D {
       offset += cell_vertices;
       total_area -= cell_area;
     }
-    std::get<4>(chunk) = true;
+    chunk.generated = true;
   }
 
   bool IsAdjacentCell(const SInt chunk_id, const SInt cell_id) {
@@ -258,49 +237,51 @@ class RGG3D : public Geometric3D {
     SInt cell_row, cell_column, cell_depth;
     DecodeCell(cell_id, cell_column, cell_row, cell_depth);
     // Iterate neighboring cells
-    for (SSInt i = -1; i <= 1; i++) {
-      SSInt neighbor_row = cell_row + i;
-      for (SSInt j = -1; j <= 1; j++) {
-        SSInt neighbor_column = cell_column + j;
-        for (SSInt k = -1; k <= 1; k++) {
-          SSInt neighbor_depth = cell_depth + k;
-
-          // Compute diffs
-          int horizontal_diff = 0;
-          int vertical_diff = 0;
-          int depth_diff = 0;
-          if (neighbor_depth < 0)
-            depth_diff = -1;
-          else if (neighbor_depth >= (SSInt)cells_per_dim_)
-            depth_diff = 1;
-          if (neighbor_column < 0)
-            horizontal_diff = -1;
-          else if (neighbor_column >= (SSInt)cells_per_dim_)
-            horizontal_diff = 1;
-          if (neighbor_row < 0)
-            vertical_diff = -1;
-          else if (neighbor_row >= (SSInt)cells_per_dim_)
-            vertical_diff = 1;
-
-          // Skip invalid cells
-          if ((SSInt)chunk_row + vertical_diff < 0 ||
-              chunk_row + vertical_diff >= chunks_per_dim_ ||
-              (SSInt)chunk_column + horizontal_diff < 0 ||
-              chunk_column + horizontal_diff >= chunks_per_dim_ ||
-              (SSInt)chunk_depth + depth_diff < 0 ||
-              chunk_depth + depth_diff >= chunks_per_dim_)
-            continue;
-
-          SInt neighbor_id =
-              Encode(chunk_column + horizontal_diff, chunk_row + vertical_diff,
-                     chunk_depth + depth_diff);
-          if (IsLocalChunk(neighbor_id)) return true;
-        }
-      }
+    for (const auto &offset : stencil_) {
+      SSInt neighbor_row = cell_row + std::get<0>(offset);
+      SSInt neighbor_column = cell_column + std::get<1>(offset);
+      SSInt neighbor_depth = cell_depth + std::get<2>(offset);
+
+      // Compute diffs
+      int horizontal_diff = 0;
+      int vertical_diff = 0;
+      int depth_diff = 0;
+      if (neighbor_depth < 0)
+        depth_diff = -1;
+      else if (neighbor_depth >= (SSInt)cells_per_dim_)
+        depth_diff = 1;
+      if (neighbor_column < 0)
+        horizontal_diff = -1;
+      else if (neighbor_column >= (SSInt)cells_per_dim_)
+        horizontal_diff = 1;
+      if (neighbor_row < 0)
+        vertical_diff = -1;
+      else if (neighbor_row >= (SSInt)cells_per_dim_)
+        vertical_diff = 1;
+
+      // Skip invalid cells
+      if ((SSInt)chunk_row + vertical_diff < 0 ||
+          chunk_row + vertical_diff >= chunks_per_dim_ ||
+          (SSInt)chunk_column + horizontal_diff < 0 ||
+          chunk_column + horizontal_diff >= chunks_per_dim_ ||
+          (SSInt)chunk_depth + depth_diff < 0 ||
+          chunk_depth + depth_diff >= chunks_per_dim_)
+        continue;
+
+      SInt neighbor_id =
+          Encode(chunk_column + horizontal_diff, chunk_row + vertical_diff,
+                 chunk_depth + depth_diff);
+      if (IsLocalChunk(neighbor_id)) return true;
     }
     return false;
   }
 
+  // Minimum distance between cells that are offset cells apart in one
+  // dimension
+  inline LPFloat CellGap(const SSInt offset) const {
+    return offset == 0 ? 0 : (std::abs(offset) - 1) * cell_size_;
+  }
+
   inline SInt EncodeCell(const SInt x, const SInt y, const SInt z) const {
     return x + y * cells_per_dim_ + z * (cells_per_dim_ * cells_per_dim_);
   }
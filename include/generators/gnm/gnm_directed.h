@@ -10,8 +10,10 @@
 #define _GNM_DIRECTED_H_
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "chunk_parallel.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
@@ -20,7 +22,7 @@
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class GNMDirected {
  public:
   GNMDirected(PGeneratorConfig &config, const PEID /* rank */,
@@ -52,16 +54,25 @@ class GNMDirected {
     end_node_ = end_chunk * nodes_per_chunk + std::min(remaining_nodes, end_chunk);
     num_nodes_ = end_node_ - start_node_ - 1;
 
-    // Generate chunks
-    for (SInt i = 0; i < num_chunks; i++) GenerateChunk(start_chunk++);
+    // Generate chunks, threads other than the first use their own generator
+    std::vector<std::unique_ptr<GNMDirected>> workers;
+    for (SInt t = 1; t < ChunkThreads(config_.threads, num_chunks); ++t) {
+      workers.emplace_back(new GNMDirected(config_, rank, cb_));
+      workers.back()->io_.DisableStreaming();
+    }
+    ParallelChunks(config_.threads, start_chunk, end_chunk,
+                   [&](SInt t, SInt begin, SInt end) {
+                     GNMDirected &gen = (t == 0) ? *this : *workers[t - 1];
+                     for (SInt chunk = begin; chunk < end; ++chunk)
+                       gen.GenerateChunk(chunk);
+                   });
+    std::vector<GeneratorIO<Edge> *> worker_io;
+    for (auto &worker : workers) worker_io.push_back(&worker->io_);
+    io_.Append(worker_io, config_.threads);
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange(), true);
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -78,7 +89,7 @@ class GNMDirected {
   RNGWrapper rng_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_; 
 
   // Constants and variables
@@ -107,7 +118,8 @@ class GNMDirected {
 
     // Generate variate
     SInt h = sampling::Spooky::hash(config_.seed + level * config_.n + chunk_start);
-    SInt variate = rng_.GenerateHypergeometric(h, n_split * edges_per_node_, m, n * edges_per_node_);
+    SInt variate = rng_.GenerateHypergeometric(h, (LInt)n_split * edges_per_node_, m,
+                                                (LInt)n * edges_per_node_);
 
     // Distributed splitting of chunks
     if (chunk_id < chunk_start + k_split) {
@@ -123,17 +135,13 @@ class GNMDirected {
                      const SInt offset) {
     // Sample from [1, num_edges]
     SInt h = sampling::Spooky::hash(config_.seed + chunk_id);
-    rng_.GenerateSample(h, n * edges_per_node_, m, [&](SInt sample) {
-      SInt source = (sample - 1) / edges_per_node_ + offset;
-      SInt target = (sample - 1) % edges_per_node_;
+    rng_.GenerateSample(h, (LInt)n * edges_per_node_, m, [&](auto sample) {
+      SInt source = (SInt)((sample - 1) / edges_per_node_) + offset;
+      SInt target = (SInt)((sample - 1) % edges_per_node_);
       if (!config_.self_loops)
         target += (((sample - 1) % edges_per_node_) >= source);
       cb_(source, target);
-#ifdef OUTPUT_EDGES
       io_.PushEdge(source, target);
-#else
-      io_.UpdateDist(source);
-#endif
     });
   }
 };
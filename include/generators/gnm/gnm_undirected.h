@@ -10,17 +10,20 @@
 #define _GNM_UNDIRECTED_H_
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "chunk_parallel.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
 #include "rng_wrapper.h"
+#include "triangular_index.h"
 #include "hash.hpp"
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class GNMUndirected {
  public:
   GNMUndirected(PGeneratorConfig &config, const PEID /* rank */,
@@ -31,34 +34,28 @@ class GNMUndirected {
     PEID rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    leftover_chunks_ = config_.k % size;
-    SInt num_chunks = config_.k / size + ((SInt)rank < leftover_chunks_);
-    SInt row = rank * num_chunks +
-               ((SInt)rank >= leftover_chunks_ ? leftover_chunks_ : 0);
-
-    nodes_per_chunk_ = config_.n / config_.k;
-    remaining_nodes_ = config_.n % config_.k;
-
-    SInt start_chunk = rank * (config_.k / size) + std::min(leftover_chunks_, (SInt)rank);
-    SInt end_chunk = start_chunk + num_chunks;
-    
-    start_node_ = start_chunk * nodes_per_chunk_ + std::min(remaining_nodes_, start_chunk);
-    end_node_ = end_chunk * nodes_per_chunk_ + std::min(remaining_nodes_, end_chunk);
-    num_nodes_ = end_node_ - start_node_;
-
-    for (SInt i = 0; i < num_chunks; i++) {
-      GenerateChunks(row);
-      row++;
+    SInt num_chunks = DistributeChunks(rank, size);
+    SInt row = start_chunk_;
+
+    // Generate rows, threads other than the first use their own generator
+    std::vector<std::unique_ptr<GNMUndirected>> workers;
+    for (SInt t = 1; t < ChunkThreads(config_.threads, num_chunks); ++t) {
+      workers.emplace_back(new GNMUndirected(config_, rank, cb_));
+      workers.back()->DistributeChunks(rank, size);
+      workers.back()->io_.DisableStreaming();
     }
+    ParallelChunks(config_.threads, row, row + num_chunks,
+                   [&](SInt t, SInt begin, SInt end) {
+                     GNMUndirected &gen = (t == 0) ? *this : *workers[t - 1];
+                     for (SInt r = begin; r < end; ++r) gen.GenerateChunks(r);
+                   });
+    std::vector<GeneratorIO<Edge> *> worker_io;
+    for (auto &worker : workers) worker_io.push_back(&worker->io_);
+    io_.Append(worker_io, config_.threads);
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange());
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -73,15 +70,33 @@ class GNMUndirected {
 
   // Globals
   SInt leftover_chunks_, nodes_per_chunk_, remaining_nodes_; 
-  SInt start_node_, end_node_, num_nodes_;
+  SInt start_chunk_, start_node_, end_node_, num_nodes_;
 
   // Variates
   RNGWrapper rng_;
+  TriangularBatch triangular_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_;
 
+  // Returns the number of rows of this PE
+  SInt DistributeChunks(const PEID rank, const PEID size) {
+    leftover_chunks_ = config_.k % size;
+    SInt num_chunks = config_.k / size + ((SInt)rank < leftover_chunks_);
+
+    nodes_per_chunk_ = config_.n / config_.k;
+    remaining_nodes_ = config_.n % config_.k;
+
+    start_chunk_ = rank * (config_.k / size) + std::min(leftover_chunks_, (SInt)rank);
+    SInt end_chunk = start_chunk_ + num_chunks;
+    
+    start_node_ = start_chunk_ * nodes_per_chunk_ + std::min(remaining_nodes_, start_chunk_);
+    end_node_ = end_chunk * nodes_per_chunk_ + std::min(remaining_nodes_, end_chunk);
+    num_nodes_ = end_node_ - start_node_;
+    return num_chunks;
+  }
+
   void GenerateChunks(const SInt row) {
     QueryTriangular(config_.m, config_.k, config_.k, row, row, 0, 0, 1);
   }
@@ -96,7 +111,7 @@ class GNMUndirected {
     // Total number of edges;
     SInt n_row = NodesInRows(num_rows, offset_row);
     SInt n_column = NodesInColumns(num_columns, offset_column);
-    HPFloat total_edges = NumTriangleEdges(n_row, n_column, config_.self_loops);
+    LInt total_edges = NumTriangleEdges(n_row, n_column, config_.self_loops);
 
     // Base Case if only one chunk is left
     if (num_rows == 1 && num_columns == 1) {
@@ -111,9 +126,9 @@ class GNMUndirected {
     SInt ul_nodes_row = NodesInRows(row_splitter, offset_row);
     SInt ll_nodes_row = NodesInRows(num_rows / 2, offset_row + row_splitter);
     SInt ll_nodes_column = NodesInColumns(column_splitter, offset_column);
-    HPFloat ul_edges = NumTriangleEdges(ul_nodes_row, ul_nodes_row);
-    HPFloat ll_edges = NumRectangleEdges(ll_nodes_row, ll_nodes_column);
-    HPFloat lr_edges = NumTriangleEdges(ll_nodes_row, ll_nodes_row);
+    LInt ul_edges = NumTriangleEdges(ul_nodes_row, ul_nodes_row);
+    LInt ll_edges = NumRectangleEdges(ll_nodes_row, ll_nodes_column);
+    LInt lr_edges = NumTriangleEdges(ll_nodes_row, ll_nodes_row);
 
     // Generate variate for quadrants
     SInt chunk_start = ChunkStart(offset_row, offset_column);
@@ -148,11 +163,12 @@ class GNMUndirected {
     // Total number of edges;
     SInt n_row = NodesInRows(num_rows, offset_row);
     SInt n_column = NodesInColumns(num_columns, offset_column);
-    HPFloat total_edges = NumRectangleEdges(n_row, n_column);
+    LInt total_edges = NumRectangleEdges(n_row, n_column);
 
     // Base Case if only one chunk is left
     if (num_rows == 1 && num_columns == 1) {
-      GenerateRectangleEdges(m, row_id, offset_column);
+      GenerateRectangleEdges(m, row_id, offset_column,
+                             StoredByRow(row_id, offset_column));
       return;
     }
 
@@ -165,8 +181,8 @@ class GNMUndirected {
     SInt ul_nodes_column = NodesInColumns(column_splitter, offset_column);
     SInt ur_nodes_column =
         NodesInColumns(num_columns / 2, offset_column + column_splitter);
-    HPFloat ul_edges = NumRectangleEdges(ul_nodes_row, ul_nodes_column);
-    HPFloat ur_edges = NumRectangleEdges(ul_nodes_row, ur_nodes_column);
+    LInt ul_edges = NumRectangleEdges(ul_nodes_row, ul_nodes_column);
+    LInt ur_edges = NumRectangleEdges(ul_nodes_row, ur_nodes_column);
 
     // Generate variate for upper/lower half
     SInt chunk_start = ChunkStart(offset_row, offset_column);
@@ -187,8 +203,8 @@ class GNMUndirected {
     } else {  // lower half
       // Compute nodes/edges per quadrant
       SInt ll_nodes_row = NodesInRows(num_rows / 2, offset_row + row_splitter);
-      HPFloat ll_edges = NumRectangleEdges(ll_nodes_row, ul_nodes_column);
-      HPFloat lr_edges = NumRectangleEdges(ll_nodes_row, ur_nodes_column);
+      LInt ll_edges = NumRectangleEdges(ll_nodes_row, ul_nodes_column);
+      LInt lr_edges = NumRectangleEdges(ll_nodes_row, ur_nodes_column);
 
       // Generate variate for lower left quadrant
       SInt ll_variate = rng_.GenerateHypergeometric(h, ll_edges, m - upper_variate, ll_edges + lr_edges);
@@ -211,12 +227,13 @@ class GNMUndirected {
     // Total number of edges;
     SInt n_row = NodesInRows(num_rows, offset_row);
     SInt n_column = NodesInColumns(num_columns, offset_column);
-    HPFloat total_edges = (HPFloat)n_row * n_column;
+    LInt total_edges = (LInt)n_row * n_column;
 
     // Base Case if only one chunk is left
     if (num_rows == 1 && num_columns == 1) {
       if (offset_row == offset_column) return;
-      GenerateRectangleEdges(m, offset_row, column_id);
+      GenerateRectangleEdges(m, offset_row, column_id,
+                             !StoredByRow(offset_row, column_id));
       return;
     }
 
@@ -230,10 +247,10 @@ class GNMUndirected {
     SInt ur_nodes_column =
         NodesInColumns(num_columns / 2, offset_column + column_splitter);
     SInt ll_nodes_row = NodesInRows(num_rows / 2, offset_row + row_splitter);
-    HPFloat ul_edges = NumRectangleEdges(ul_nodes_row, ul_nodes_column);
-    HPFloat ur_edges = NumRectangleEdges(ul_nodes_row, ur_nodes_column);
-    HPFloat ll_edges = NumRectangleEdges(ll_nodes_row, ul_nodes_column);
-    HPFloat lr_edges = NumRectangleEdges(ll_nodes_row, ur_nodes_column);
+    LInt ul_edges = NumRectangleEdges(ul_nodes_row, ul_nodes_column);
+    LInt ur_edges = NumRectangleEdges(ul_nodes_row, ur_nodes_column);
+    LInt ll_edges = NumRectangleEdges(ll_nodes_row, ul_nodes_column);
+    LInt lr_edges = NumRectangleEdges(ll_nodes_row, ur_nodes_column);
 
     // Generate variate for upper/lower half
     SInt chunk_start = ChunkStart(offset_row, offset_column);
@@ -272,62 +289,56 @@ class GNMUndirected {
     // Number edges
     SInt n_row = NodesInRow(row_id);
     SInt n_column = NodesInColumn(column_id);
-    HPFloat total_edges = NumTriangleEdges(n_row, n_column, config_.self_loops);
+    LInt total_edges = NumTriangleEdges(n_row, n_column, config_.self_loops);
 
-    // Sample from [1, total_edges]
-    SInt h =
-        sampling::Spooky::hash(config_.seed + (((row_id + 1) * row_id) / 2) + column_id);
-    rng_.GenerateSample(h, total_edges, m, [&](SInt sample) {
-      // Absolute triangular point
-      // if (loops) sqr = (sqrt(8*((double)sample-1)+1) - 1)/2 + 1;
-      SInt sqr = sqrt(8 * (sample - 1) + 1);
-      // TODO: Nasty hack
-      while (sqr * sqr > 8 * (sample - 1) + 1) sqr--;
-      SInt i = (sqr - 1) / 2;
-      SInt j = (sample - 1) - i * (i + 1) / 2;
+    // Absolute triangular points, decoded in batches
+    auto emit = [&](SInt i, SInt j) {
       cb_(i + offset_row, j + offset_column);
       cb_(j + offset_column, i + offset_row);
-#ifdef OUTPUT_EDGES
       io_.PushEdge(i + offset_row, j + offset_column);
       io_.PushEdge(j + offset_column, i + offset_row);
-#else
-      io_.UpdateDist(i + offset_row);
-      io_.UpdateDist(j + offset_column);
-#endif
+    };
+
+    // Sample from [1, total_edges]
+    SInt h =
+        sampling::Spooky::hash(config_.seed + (((row_id + 1) * row_id) / 2) + column_id);
+    rng_.GenerateSample(h, total_edges, m, [&](auto sample) {
+      triangular_.Push(sample - 1, emit);
     });
+    triangular_.Flush(emit);
   }
 
   void GenerateRectangleEdges(const SInt m, const SInt row_id,
-                              const SInt column_id) {
+                              const SInt column_id, const bool store) {
     SInt offset_row = OffsetInRow(row_id);
     SInt offset_column = OffsetInColumn(column_id);
-    bool local_row = (offset_row >= start_node_ && offset_row < end_node_);
 
     // Sample from [1, num_edges]
     SInt n_row = NodesInRow(row_id);
     SInt n_column = NodesInColumn(column_id);
-    HPFloat total_edges = NumRectangleEdges(n_row, n_column);
+    LInt total_edges = NumRectangleEdges(n_row, n_column);
 
     // Sample from [1, total_edges]
     SInt h =
         sampling::Spooky::hash(config_.seed + (((row_id + 1) * row_id) / 2) + column_id);
-    rng_.GenerateSample(h, total_edges, m, [&](SInt sample) {
-      SInt i = (sample - 1) / n_column;
-      SInt j = (sample - 1) % n_column;
+    rng_.GenerateSample(h, total_edges, m, [&](auto sample) {
+      SInt i = (SInt)((sample - 1) / n_column);
+      SInt j = (SInt)((sample - 1) % n_column);
       cb_(i + offset_row, j + offset_column);
       cb_(j + offset_column, i + offset_row);
-#ifdef OUTPUT_EDGES
-      if (local_row) {
+      if (store) {
         io_.PushEdge(i + offset_row, j + offset_column);
         io_.PushEdge(j + offset_column, i + offset_row);
       }
-#else 
-      io_.UpdateDist(i + offset_row);
-      io_.UpdateDist(j + offset_column);
-#endif
     });
   }
 
+  // Row and column PE both sample a rectangle chunk, the parity decides
+  // which one keeps its edges (balanced like in GNPUndirected)
+  inline bool StoredByRow(const SInt row_id, const SInt column_id) const {
+    return (row_id + column_id) & 1;
+  }
+
   inline SInt NodesInRows(const SInt rows, const SInt offset) const {
     return nodes_per_chunk_ * rows +
            std::min(remaining_nodes_ - offset, rows);
@@ -358,14 +369,14 @@ class GNMUndirected {
     return (((row + 1) * row) / 2) + column;
   }
 
-  inline HPFloat NumTriangleEdges(const HPFloat row, const HPFloat column,
-                                  bool loops = false) const {
+  // Exact in 128 bits, n(n - 1) / 2 exceeds 64 bits from n = 2^32.5 on
+  inline LInt NumTriangleEdges(const LInt row, const LInt column,
+                               bool loops = false) const {
     return (loops && config_.self_loops) ? row * (column + 1) / 2
                                          : row * (column - 1) / 2;
   }
 
-  inline HPFloat NumRectangleEdges(const HPFloat row,
-                                   const HPFloat column) const {
+  inline LInt NumRectangleEdges(const LInt row, const LInt column) const {
     return row * column;
   }
 };
@@ -10,8 +10,10 @@
 #define _GNP_DIRECTED_H_
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "chunk_parallel.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
@@ -20,7 +22,7 @@
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class GNPDirected {
  public:
   GNPDirected(PGeneratorConfig &config, const PEID /* rank */,
@@ -51,21 +53,31 @@ class GNPDirected {
     end_node_ = end_chunk * nodes_per_chunk + std::min(end_chunk, remaining_nodes);
     num_nodes_ = end_node_ - start_node_ - 1;
 
-    // Generate chunks
-    SInt current_node = start_node_;
-    for (SInt i = 0; i < num_chunks; i++) {
-      SInt nodes_for_chunk = nodes_per_chunk + (start_chunk < remaining_nodes);
-      GenerateChunk(start_chunk++, current_node, nodes_for_chunk);
-      current_node += nodes_for_chunk;
+    // Generate chunks, threads other than the first use their own generator
+    std::vector<std::unique_ptr<GNPDirected>> workers;
+    for (SInt t = 1; t < ChunkThreads(config_.threads, num_chunks); ++t) {
+      workers.emplace_back(new GNPDirected(config_, rank, cb_));
+      workers.back()->io_.DisableStreaming();
     }
+    ParallelChunks(config_.threads, start_chunk, end_chunk,
+                   [&](SInt t, SInt begin, SInt end) {
+                     GNPDirected &gen = (t == 0) ? *this : *workers[t - 1];
+                     SInt current_node = begin * nodes_per_chunk +
+                                         std::min(begin, remaining_nodes);
+                     for (SInt chunk = begin; chunk < end; ++chunk) {
+                       SInt nodes_for_chunk =
+                           nodes_per_chunk + (chunk < remaining_nodes);
+                       gen.GenerateChunk(chunk, current_node, nodes_for_chunk);
+                       current_node += nodes_for_chunk;
+                     }
+                   });
+    std::vector<GeneratorIO<Edge> *> worker_io;
+    for (auto &worker : workers) worker_io.push_back(&worker->io_);
+    io_.Append(worker_io, config_.threads);
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange(), true);
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -82,7 +94,7 @@ class GNPDirected {
   RNGWrapper rng_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_;
 
   // Constants and variables
@@ -95,24 +107,28 @@ class GNPDirected {
 
   void GenerateEdges(const SInt n, const double p, const SInt chunk_id,
                      const SInt offset) {
-    // Generate variate
+    auto emit = [&](auto sample) {
+      SInt source = (SInt)((sample - 1) / edges_per_node) + offset;
+      SInt target = (SInt)((sample - 1) % edges_per_node);
+      if (!config_.self_loops)
+        target += ((sample - 1) % edges_per_node >= source);
+      cb_(source, target);
+      io_.PushEdge(source, target);
+    };
     SInt h = sampling::Spooky::hash(config_.seed + chunk_id);
-    SInt num_edges = rng_.GenerateBinomial(h, n * edges_per_node, p);
+    LInt total_edges = (LInt)n * edges_per_node;
+
+    // Edges sorted by source
+    if (config_.skip_sampling) {
+      rng_.GenerateSkipSample(h, total_edges, p, emit);
+      return;
+    }
+
+    // Generate variate
+    SInt num_edges = rng_.GenerateBinomial(h, total_edges, p);
 
     // Sample from [1, num_edges]
-    rng_.GenerateSample(h, n * edges_per_node, num_edges, [&](SInt sample) {
-                          SInt source = (sample - 1) / edges_per_node + offset;
-                          SInt target = (sample - 1) % edges_per_node;
-                          if (!config_.self_loops)
-                            target += ((sample - 1) % edges_per_node >= source);
-                          cb_(source, target);
-#ifdef OUTPUT_EDGES
-                          io_.PushEdge(source, target);
-#else
-                          io_.UpdateDist(source);
-                          io_.UpdateDist(target);
-#endif
-                        });
+    rng_.GenerateSample(h, total_edges, num_edges, emit);
   }
 };
 
@@ -10,17 +10,20 @@
 #define _GNP_UNDIRECTED_H_
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
+#include "chunk_parallel.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
 #include "rng_wrapper.h"
+#include "triangular_index.h"
 #include "hash.hpp"
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class GNPUndirected {
  public:
   GNPUndirected(PGeneratorConfig &config, const PEID /* rank */,
@@ -46,50 +49,24 @@ class GNPUndirected {
     end_node_ = end_chunk * nodes_per_chunk + std::min(remaining_nodes, end_chunk);
     num_nodes_ = end_node_ - start_node_ - 1;
 
-    // Generate chunks
-    for (SInt i = 0; i < num_chunks; i++) {
-      SInt row_n = 0;
-      SInt column_n = 0;
-      SInt row_node_id =
-          start_chunk * nodes_per_chunk + std::min(start_chunk, remaining_nodes);
-      SInt column_node_id = 0;
-      SInt current_row = start_chunk++;
-      SInt current_column = 0;
-      // Iterate current_row
-      while (current_column < current_row) {
-        row_n = nodes_per_chunk + (current_row < remaining_nodes);
-        column_n = nodes_per_chunk + (current_column < remaining_nodes);
-        GenerateRectangleChunk(current_row, current_column++, row_node_id,
-                               column_node_id, row_n, column_n);
-        column_node_id += column_n;
-      }
-      // Handle triangular section
-      if (current_row < config_.k) {
-        row_n = nodes_per_chunk + (current_row < remaining_nodes);
-        column_n = nodes_per_chunk + (current_column < remaining_nodes);
-        // TODO: Triangle chunk
-        GenerateTriangleChunk(current_row++, current_column,
-                              row_node_id + (!config_.self_loops), column_node_id,
-                              row_n, column_n);
-        row_node_id += row_n;
-      }
-      // Iterate current_column
-      while (current_row < config_.k) {
-        row_n = nodes_per_chunk + (current_row < remaining_nodes);
-        column_n = nodes_per_chunk + (current_column < remaining_nodes);
-        GenerateRectangleChunk(current_row++, current_column, row_node_id,
-                               column_node_id, row_n, column_n);
-        row_node_id += row_n;
-      }
+    // Generate rows, threads other than the first use their own generator
+    std::vector<std::unique_ptr<GNPUndirected>> workers;
+    for (SInt t = 1; t < ChunkThreads(config_.threads, num_chunks); ++t) {
+      workers.emplace_back(new GNPUndirected(config_, rank, cb_));
+      workers.back()->io_.DisableStreaming();
     }
+    ParallelChunks(config_.threads, start_chunk, end_chunk,
+                   [&](SInt t, SInt begin, SInt end) {
+                     GNPUndirected &gen = (t == 0) ? *this : *workers[t - 1];
+                     for (SInt row = begin; row < end; ++row) gen.GenerateRow(row);
+                   });
+    std::vector<GeneratorIO<Edge> *> worker_io;
+    for (auto &worker : workers) worker_io.push_back(&worker->io_);
+    io_.Append(worker_io, config_.threads);
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange());
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -104,15 +81,65 @@ class GNPUndirected {
 
   // Variates
   RNGWrapper rng_;
+  TriangularBatch triangular_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_;
 
   // Constants and variables
   SInt nodes_per_chunk;
   SInt start_node_, end_node_, num_nodes_;
 
+  // Rectangles left of the row, the triangle and rectangles below it
+  void GenerateRow(const SInt row) {
+    SInt nodes_per_chunk = config_.n / config_.k;
+    SInt remaining_nodes = config_.n % config_.k;
+    SInt row_n = 0;
+    SInt column_n = 0;
+    SInt row_node_id = row * nodes_per_chunk + std::min(row, remaining_nodes);
+    SInt column_node_id = 0;
+    SInt current_row = row;
+    SInt current_column = 0;
+    // Iterate current_row
+    while (current_column < current_row) {
+      row_n = nodes_per_chunk + (current_row < remaining_nodes);
+      column_n = nodes_per_chunk + (current_column < remaining_nodes);
+      GenerateRectangleChunk(current_row, current_column, row_node_id,
+                             column_node_id, row_n, column_n,
+                             StoredByRow(current_row, current_column));
+      current_column++;
+      column_node_id += column_n;
+    }
+    // Handle triangular section
+    if (current_row < config_.k) {
+      row_n = nodes_per_chunk + (current_row < remaining_nodes);
+      column_n = nodes_per_chunk + (current_column < remaining_nodes);
+      // TODO: Triangle chunk
+      GenerateTriangleChunk(current_row++, current_column,
+                            row_node_id + (!config_.self_loops), column_node_id,
+                            row_n, column_n);
+      row_node_id += row_n;
+    }
+    // Iterate current_column
+    while (current_row < config_.k) {
+      row_n = nodes_per_chunk + (current_row < remaining_nodes);
+      column_n = nodes_per_chunk + (current_column < remaining_nodes);
+      GenerateRectangleChunk(current_row, current_column, row_node_id,
+                             column_node_id, row_n, column_n,
+                             !StoredByRow(current_row, current_column));
+      current_row++;
+      row_node_id += row_n;
+    }
+  }
+
+  // Rectangle chunks are generated by the PEs of their row and their column,
+  // only one of them stores the edges. Alternating by parity gives every row
+  // (k - 1) / 2 stored rectangles instead of row_id many.
+  inline bool StoredByRow(const SInt row_id, const SInt column_id) const {
+    return (row_id + column_id) & 1;
+  }
+
   void GenerateTriangleChunk(const SInt row_id, const SInt column_id,
                              const SInt row_node_id, const SInt column_node_id,
                              const SInt row_n, const SInt column_n) {
@@ -122,9 +149,10 @@ class GNPUndirected {
 
   void GenerateRectangleChunk(const SInt row_id, const SInt column_id,
                               const SInt row_node_id, const SInt column_node_id,
-                              const SInt row_n, const SInt column_n) {
+                              const SInt row_n, const SInt column_n,
+                              const bool store) {
     GenerateRectangleEdges(row_n, column_n, config_.p, row_id, column_id,
-                           row_node_id, column_node_id);
+                           row_node_id, column_node_id, store);
   }
 
   void GenerateTriangularEdges(const SInt row_n, const SInt column_n,
@@ -132,65 +160,72 @@ class GNPUndirected {
                                const SInt column_id, const SInt offset_row,
                                const SInt offset_column) {
     // Number of edges
-    SInt total_edges = 0;
+    LInt total_edges = 0;
     if (!config_.self_loops)
-      total_edges = row_n * (column_n - 1) / 2;
+      total_edges = (LInt)row_n * (column_n - 1) / 2;
     else
-      total_edges = row_n * (column_n + 1) / 2;
+      total_edges = (LInt)row_n * (column_n + 1) / 2;
     bool local_row = (offset_row >= start_node_ && offset_row < end_node_);
 
-    // Generate variate
+    // Absolute triangular points, decoded in batches
+    auto emit = [&](SInt i, SInt j) {
+      cb_(i + offset_row, j + offset_column);
+      cb_(j + offset_column, i + offset_row);
+      io_.PushEdge(i + offset_row, j + offset_column);
+      io_.PushEdge(j + offset_column, i + offset_row);
+    };
     SInt h =
         sampling::Spooky::hash(config_.seed + (((row_id + 1) * row_id) / 2) + column_id);
+
+    // Rows in ascending order
+    if (config_.skip_sampling) {
+      rng_.GenerateSkipSample(h, total_edges, p, [&](auto sample) {
+        decltype(sample) i, j;
+        TriangularIndex::Decode(sample - 1, i, j);
+        emit(i, j);
+      });
+      return;
+    }
+
+    // Generate variate
     SInt num_edges = rng_.GenerateBinomial(h, total_edges, p);
 
     // Sample from [1, num_edges]
-    rng_.GenerateSample(h, total_edges, num_edges, [&](SInt sample) {
-      // Absolute triangular point
-      // if (loops) sqr = (sqrt(8*((double)sample-1)+1) - 1)/2 + 1;
-      SInt sqr = sqrt(8 * (sample - 1) + 1);
-      // TODO: Nasty hack
-      while (sqr * sqr > 8 * (sample - 1) + 1) sqr--;
-      SInt i = (sqr - 1) / 2;
-      SInt j = (sample - 1) - i * (i + 1) / 2;
-      cb_(i + offset_row, j + offset_column);
-      cb_(j + offset_column, i + offset_row);
-#ifdef OUTPUT_EDGES
-      io_.PushEdge(i + offset_row, j + offset_column);
-      io_.PushEdge(j + offset_column, i + offset_row);
-#else
-      io_.UpdateDist(i + offset_row);
-      io_.UpdateDist(j + offset_column);
-#endif
+    rng_.GenerateSample(h, total_edges, num_edges, [&](auto sample) {
+      triangular_.Push(sample - 1, emit);
     });
+    triangular_.Flush(emit);
   }
 
   void GenerateRectangleEdges(const SInt row_n, const SInt column_n,
                               const double p, const SInt row_id,
                               const SInt column_id, const SInt offset_row,
-                              const SInt offset_column) {
-    // Generate variate
+                              const SInt offset_column, const bool store) {
+    auto emit = [&](auto sample) {
+      SInt i = (SInt)((sample - 1) / column_n);
+      SInt j = (SInt)((sample - 1) % column_n);
+      cb_(i + offset_row, j + offset_column);
+      cb_(j + offset_column, i + offset_row);
+      if (store) {
+        io_.PushEdge(i + offset_row, j + offset_column);
+        io_.PushEdge(j + offset_column, i + offset_row);
+      }
+    };
     SInt h =
         sampling::Spooky::hash(config_.seed + (((row_id + 1) * row_id) / 2) + column_id);
-    SInt num_edges = rng_.GenerateBinomial(h, row_n * column_n, p);
-    bool local_row = (offset_row >= start_node_ && offset_row < end_node_);
+    LInt total_edges = (LInt)row_n * column_n;
+
+    // Rows in ascending order
+    if (config_.skip_sampling) {
+      rng_.GenerateSkipSample(h, total_edges, p, emit);
+      return;
+    }
+
+    // Generate variate
+    SInt num_edges = rng_.GenerateBinomial(h, total_edges, p);
 
     // Sample from [1, num_edges]
-    rng_.GenerateSample(h, row_n * column_n, num_edges, [&](SInt sample) {
-                          SInt i = (sample - 1) / column_n;
-                          SInt j = (sample - 1) % column_n;
-                          cb_(i + offset_row, j + offset_column);
-                          cb_(j + offset_column, i + offset_row);
-#ifdef OUTPUT_EDGES
-                          if (local_row) {
-                            io_.PushEdge(i + offset_row, j + offset_column);
-                            io_.PushEdge(j + offset_column, i + offset_row);
-                          }
-#else
-                          io_.UpdateDist(i + offset_row);
-                          io_.UpdateDist(j + offset_column);
-#endif
-                        });
+    rng_.GenerateSample(h, total_edges, num_edges, emit);
   }
 };
 
@@ -17,11 +17,12 @@
 #include "generator_config.h"
 #include "generator_io.h"
 #include "rng_wrapper.h"
+#include "wide_index.h"
 #include "hash.hpp"
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class Grid3D {
  public:
   Grid3D(PGeneratorConfig &config, const PEID /* rank */,
@@ -72,12 +73,8 @@ class Grid3D {
     }
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange());
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -94,7 +91,7 @@ class Grid3D {
   RNGWrapper rng_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_; 
 
   // Constants and variables
@@ -231,18 +228,13 @@ class Grid3D {
   }
 
   void GenerateEdge(const SInt source, const SInt target) {
-    SInt edge_seed = std::min(source, target) * total_y_ * total_x_ * total_z_ 
-                      + std::max(source, target);
-    SInt h = sampling::Spooky::hash(config_.seed + edge_seed);
+    // Pair index in [0, n^2), wider than 64 bits for n > 2^32
+    LInt edge_seed = (LInt)std::min(source, target) * config_.n + std::max(source, target);
+    SInt h = sampling::Spooky::hash(config_.seed + WideIndex::Seed(edge_seed));
     if (rng_.GenerateBinomial(h, 1, edge_probability_)) {
       cb_(source, target);
       //cb_(target, source);
-#ifdef OUTPUT_EDGES
       io_.PushEdge(source, target);
-#else
-      io_.UpdateDist(source);
-      io_.UpdateDist(target);
-#endif
     }
   }
 
@@ -27,7 +27,7 @@
 
 namespace kagen {
 
-template <typename EdgeCallback> 
+template <typename EdgeCallback, typename Edge = Edge64>
 class Hyperbolic {
  public:
   // n, min_r, max_r, generated, offset
@@ -131,12 +131,8 @@ class Hyperbolic {
     //   std::cout << "generated edges" << std::endl;
   }
 
-  void Output() const { 
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges(); 
-#else
-    io_.OutputDist(); 
-#endif
+  void Output() { 
+    io_.Output(GetVertexRange());
   }
   
   std::pair<SInt, SInt> GetVertexRange() {
@@ -156,7 +152,7 @@ class Hyperbolic {
   SortedMersenne sorted_mersenne;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_; 
   // FILE* edge_file;
 
@@ -590,15 +586,10 @@ class Hyperbolic {
         if (PGGeometry::HyperbolicDistance(q, v) <= pdm_target_r_) {
           cb_(std::get<5>(q), std::get<5>(v));
           cb_(std::get<5>(v), std::get<5>(q));
-#ifdef OUTPUT_EDGES
           // if (rank_ == 2)
           //   printf("e %lld %f %f %lld %f %f %d %f\n", std::get<5>(q), std::get<1>(q), std::get<0>(q), std::get<5>(v), std::get<1>(v), std::get<0>(v), rank_, PGGeometry::HyperbolicDistance(q, v));
           io_.PushEdge(std::get<5>(q), std::get<5>(v));
           io_.PushEdge(std::get<5>(v), std::get<5>(q));
-#else
-          io_.UpdateDist(std::get<5>(q));
-          io_.UpdateDist(std::get<5>(v));
-#endif
         }
       }
     }
@@ -609,15 +600,10 @@ class Hyperbolic {
         if (PGGeometry::HyperbolicDistance(q, v) <= pdm_target_r_) {
           cb_(std::get<5>(q), std::get<5>(v));
           cb_(std::get<5>(v), std::get<5>(q));
-#ifdef OUTPUT_EDGES
           // if (rank_ == 2)
           //   printf("e %lld %f %f %lld %f %f %d %f\n", std::get<5>(q), std::get<1>(q), std::get<0>(q), std::get<5>(v), std::get<1>(v), std::get<0>(v), rank_, PGGeometry::HyperbolicDistance(q, v));
           io_.PushEdge(std::get<5>(q), std::get<5>(v));
           if (IsLocalChunk(chunk_id)) io_.PushEdge(std::get<5>(v), std::get<5>(q));
-#else
-          io_.UpdateDist(std::get<5>(q));
-          io_.UpdateDist(std::get<5>(v));
-#endif
         }
       }
     }
@@ -16,6 +16,10 @@
 #include <stdio.h>
 #include <assert.h>
 
+#include <memory>
+#include <vector>
+
+#include "chunk_parallel.h"
 #include "definitions.h"
 #include "generator_config.h"
 #include "generator_io.h"
@@ -52,24 +56,18 @@ namespace kagen {
 
 #ifdef GENERATOR_USE_PACKED_EDGE_TYPE
 
-typedef struct packed_edge {
-  uint32_t v0_low;
-  uint32_t v1_low;
-  uint32_t high; /* v1 in high half, v0 in low half */
-} packed_edge;
+typedef PackedEdge48 packed_edge;
 
 static inline int64_t get_v0_from_edge(const packed_edge* p) {
-  return (p->v0_low | ((int64_t)((int16_t)(p->high & 0xFFFF)) << 32));
+  return p->Source();
 }
 
 static inline int64_t get_v1_from_edge(const packed_edge* p) {
-  return (p->v1_low | ((int64_t)((int16_t)(p->high >> 16)) << 32));
+  return p->Target();
 }
 
 static inline void write_edge(packed_edge* p, int64_t v0, int64_t v1) {
-  p->v0_low = (uint32_t)v0;
-  p->v1_low = (uint32_t)v1;
-  p->high = (uint32_t)(((v0 >> 32) & 0xFFFF) | (((v1 >> 32) & 0xFFFF) << 16));
+  *p = PackedEdge48(v0, v1);
 }
 
 #else
@@ -94,7 +92,7 @@ static inline void write_edge(packed_edge* p, int64_t v0, int64_t v1) {
 
 #endif
 
-template <typename EdgeCallback>
+template <typename EdgeCallback, typename Edge = Edge64>
 class Kronecker {
  public:
   Kronecker(PGeneratorConfig &config, const PEID rank, 
@@ -115,41 +113,33 @@ class Kronecker {
   }
 
   void Generate() {
-    uint_fast32_t seed[5];
-    make_mrg_seed(sampling::Spooky::hash((config_.seed + 1) * size_), sampling::Spooky::hash(rank_), seed);
-
-    mrg_state state;
-
-    mrg_seed(&state, seed);
-
-    uint64_t scramble1_, scramble2_; /* Values for scrambling */
-    {
-      mrg_state new_state = state;
-      mrg_skip(&new_state, 50, 7, 0);
-      scramble1_ = mrg_get_uint_orig(&new_state);
-      scramble1_ *= UINT64_C(0xFFFFFFFF);
-      scramble1_ += mrg_get_uint_orig(&new_state);
-      scramble2_ = mrg_get_uint_orig(&new_state);
-      scramble2_ *= UINT64_C(0xFFFFFFFF);
-      scramble2_ += mrg_get_uint_orig(&new_state);
-    }
-
-#ifdef _OPENMP
-#pragma omp parallel for
-#endif
-    for (SInt i = 0; i < num_edges_; ++i) {
-      mrg_state new_state = state;
-      mrg_skip(&new_state, 0, (uint64_t)i, 0);
-      GenerateEdge(config_.n, 0, &new_state);
+    mrg_state state = InitState();
+
+    // Edges are independent, every thread generates a contiguous block of
+    // them into the buffer of its own generator
+    std::vector<std::unique_ptr<Kronecker>> workers;
+    for (SInt t = 1; t < ChunkThreads(config_.threads, num_edges_); ++t) {
+      workers.emplace_back(new Kronecker(config_, rank_, cb_));
+      workers.back()->InitState();
+      workers.back()->io_.DisableStreaming();
     }
+    ParallelChunks(config_.threads, 0, num_edges_,
+                   [&](SInt t, SInt begin, SInt end) {
+                     Kronecker &gen = (t == 0) ? *this : *workers[t - 1];
+                     gen.io_.ReserveEdges(end - begin);
+                     for (SInt i = begin; i < end; ++i) {
+                       mrg_state new_state = state;
+                       mrg_skip(&new_state, 0, (uint64_t)i, 0);
+                       gen.GenerateEdge(config_.n, 0, &new_state);
+                     }
+                   });
+    std::vector<GeneratorIO<Edge> *> worker_io;
+    for (auto &worker : workers) worker_io.push_back(&worker->io_);
+    io_.Append(worker_io, config_.threads);
   }
 
   void Output() {
-#ifdef OUTPUT_EDGES
-    io_.OutputEdges();
-#else
-    io_.OutputDist();
-#endif
+    io_.Output(GetVertexRange());
   }
 
   std::pair<SInt, SInt> GetVertexRange() {
@@ -164,7 +154,7 @@ class Kronecker {
   PEID size_, rank_;
 
   // I/O
-  GeneratorIO<> io_;
+  GeneratorIO<Edge> io_;
   EdgeCallback cb_;
 
   // Constants and variables
@@ -174,6 +164,28 @@ class Kronecker {
   int64_t scramble1_, scramble2_;
   SInt edges_per_pe_;
 
+  // MRG state of this PE, also sets the scrambling values
+  mrg_state InitState() {
+    uint_fast32_t seed[5];
+    make_mrg_seed(sampling::Spooky::hash((config_.seed + 1) * size_), sampling::Spooky::hash(rank_), seed);
+
+    mrg_state state;
+
+    mrg_seed(&state, seed);
+
+    {
+      mrg_state new_state = state;
+      mrg_skip(&new_state, 50, 7, 0);
+      scramble1_ = mrg_get_uint_orig(&new_state);
+      scramble1_ *= UINT64_C(0xFFFFFFFF);
+      scramble1_ += mrg_get_uint_orig(&new_state);
+      scramble2_ = mrg_get_uint_orig(&new_state);
+      scramble2_ *= UINT64_C(0xFFFFFFFF);
+      scramble2_ += mrg_get_uint_orig(&new_state);
+    }
+    return state;
+  }
+
   int Bernoulli(mrg_state* st, int level, int nlevels) {
 #if SPK_NOISE_LEVEL == 0
     /* Avoid warnings */
@@ -296,12 +308,9 @@ class Kronecker {
       base_src += n * src_offset;
       base_tgt += n * tgt_offset;
     }
-#ifdef OUTPUT_EDGES
-    io_.PushEdge(Scramble(base_src), Scramble(base_tgt));
-#else
-    io_.UpdateDist(Scramble(base_src));
-    io_.UpdateDist(Scramble(base_tgt));
-#endif
+    int64_t source = Scramble(base_src), target = Scramble(base_tgt);
+    cb_(source, target);
+    io_.PushEdge(source, target);
   }
 };
 
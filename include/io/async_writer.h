@@ -0,0 +1,224 @@
+/*******************************************************************************
+ * include/io/async_writer.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _ASYNC_WRITER_H_
+#define _ASYNC_WRITER_H_
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Double-buffered file writer
+// The caller fills one buffer while a background thread writes the other one
+// to disk with large sequential writes (optionally bypassing the page cache).
+// Every write except the last one covers exactly one buffer, records that
+// cross the end of a buffer are continued in the next one, so direct I/O
+// only sees aligned write sizes.
+class AsyncWriter {
+ public:
+  static constexpr SInt ALIGNMENT = 4096;
+
+  AsyncWriter(const std::string& filename, bool direct_io = false,
+              SInt buffer_size = (SInt)1 << 24)
+      : buffer_size_(RoundUp(buffer_size)),
+        current_(0),
+        fill_(0),
+        offset_(0),
+        pending_(-1),
+        pending_size_(0),
+        pending_offset_(0),
+        stop_(false),
+        failed_(false),
+        direct_io_(false) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+    if (direct_io) {
+      fd_ = open(filename.c_str(), flags | O_DIRECT, 0644);
+      direct_io_ = fd_ >= 0;
+    }
+#else
+    (void)direct_io;
+#endif
+    // Fall back to buffered I/O if the filesystem rejects O_DIRECT
+    if (!direct_io_) fd_ = open(filename.c_str(), flags, 0644);
+    if (fd_ < 0) {
+      perror(("Could not open " + filename).c_str());
+      failed_ = true;
+    }
+
+    // Room for a reservation that starts just before the end of the buffer
+    for (int i = 0; i < 2; ++i) {
+      if (posix_memalign((void**)&buffers_[i], ALIGNMENT, 2 * buffer_size_) != 0) {
+        fprintf(stderr, "Could not allocate output buffer\n");
+        abort();
+      }
+    }
+    thread_ = std::thread([this]() { WriterLoop(); });
+  }
+
+  AsyncWriter(const AsyncWriter&) = delete;
+  AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+  ~AsyncWriter() {
+    Close();
+    free(buffers_[0]);
+    free(buffers_[1]);
+  }
+
+  void Write(const char* data, SInt size) {
+    while (size > 0) {
+      SInt length = std::min(size, buffer_size_ - fill_);
+      memcpy(buffers_[current_] + fill_, data, length);
+      fill_ += length;
+      data += length;
+      size -= length;
+      if (fill_ == buffer_size_) Submit();
+    }
+  }
+
+  // Reserve space in the current buffer for max_size <= BufferSize() bytes
+  // Commit() has to be called with the number of bytes actually used
+  inline char* Reserve(SInt) { return buffers_[current_] + fill_; }
+
+  inline void Commit(SInt size) {
+    fill_ += size;
+    if (fill_ >= buffer_size_) Submit();
+  }
+
+  SInt BufferSize() const { return buffer_size_; }
+
+  // Write remaining data and wait for the writer thread
+  // Returns false if any write failed
+  bool Close() {
+    if (!thread_.joinable()) return !failed_;
+    SInt file_size = offset_ + fill_;
+    bool padded = false;
+    if (fill_ > 0) {
+      // Direct I/O requires aligned write sizes, the padding is truncated
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return pending_ < 0; });
+        padded = direct_io_;
+      }
+      if (padded) {
+        SInt padded = RoundUp(fill_);
+        memset(buffers_[current_] + fill_, 0, padded - fill_);
+        fill_ = padded;
+      }
+      Submit();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return pending_ < 0; });
+      stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    if (fd_ >= 0) {
+      if (padded && ftruncate(fd_, file_size) != 0) failed_ = true;
+      close(fd_);
+      fd_ = -1;
+    }
+    return !failed_;
+  }
+
+ private:
+  SInt buffer_size_;
+  char* buffers_[2];
+  int current_;
+  SInt fill_;
+  SInt offset_;
+  int fd_;
+
+  // Writer thread state
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int pending_;
+  SInt pending_size_;
+  SInt pending_offset_;
+  bool stop_;
+  bool failed_;
+  bool direct_io_;
+
+  static inline SInt RoundUp(SInt size) {
+    return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  }
+
+  // Hand (at most) one buffer of data to the writer thread and switch
+  // buffers, bytes beyond the buffer size start the next buffer
+  void Submit() {
+    SInt size = std::min(fill_, buffer_size_);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return pending_ < 0; });
+      pending_ = current_;
+      pending_size_ = size;
+      pending_offset_ = offset_;
+    }
+    cv_.notify_all();
+    // The writer thread only reads the first size bytes
+    SInt overflow = fill_ - size;
+    memcpy(buffers_[current_ ^ 1], buffers_[current_] + size, overflow);
+    offset_ += size;
+    current_ ^= 1;
+    fill_ = overflow;
+  }
+
+  void WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this]() { return pending_ >= 0 || stop_; });
+      if (pending_ < 0) return;
+
+      const char* data = buffers_[pending_];
+      SInt size = pending_size_;
+      SInt offset = pending_offset_;
+      lock.unlock();
+      while (size > 0 && fd_ >= 0) {
+        ssize_t written = pwrite(fd_, data, size, offset);
+#ifdef O_DIRECT
+        // Some filesystems accept O_DIRECT on open but reject the writes
+        if (written < 0 && errno == EINVAL && direct_io_) {
+          fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+          direct_io_ = false;
+          continue;
+        }
+#endif
+        if (written <= 0) {
+          perror("Could not write output");
+          failed_ = true;
+          break;
+        }
+        data += written;
+        size -= written;
+        offset += written;
+      }
+      lock.lock();
+      pending_ = -1;
+      cv_.notify_all();
+    }
+  }
+};
+
+}
+#endif
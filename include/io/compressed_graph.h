@@ -0,0 +1,240 @@
+/*******************************************************************************
+ * include/io/compressed_graph.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _COMPRESSED_GRAPH_H_
+#define _COMPRESSED_GRAPH_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "edge_types.h"
+
+namespace kagen {
+
+// Gap encoded adjacency format
+//
+// Layout: header, block index, adjacency data
+// Each vertex is stored as varint(degree), followed by the zigzag encoded
+// difference of its first neighbor to the vertex itself and the gaps between
+// consecutive (sorted) neighbors as varints.
+// The block index holds the data offset of every block_size-th vertex
+// (counted from first_vertex), so single neighborhoods can be decoded without
+// scanning the whole file.
+struct CompressedGraphHeader {
+  char magic[8];
+  // Total number of vertices
+  SInt n;
+  // Number of adjacency entries in this file
+  SInt m;
+  // Vertices [first_vertex, first_vertex + num_vertices) are stored
+  SInt first_vertex;
+  SInt num_vertices;
+  // Vertices per index block
+  SInt block_size;
+  SInt num_blocks;
+};
+
+static constexpr char COMPRESSED_GRAPH_MAGIC[8] = {'K', 'A', 'G', 'E',
+                                                   'N', 'G', 'A', 'P'};
+
+class GapEncoding {
+ public:
+  static constexpr SInt MAX_VARINT_BYTES = 10;
+
+  static inline char* WriteVarInt(char* out, SInt value) {
+    while (value >= 0x80) {
+      *out++ = (char)(value | 0x80);
+      value >>= 7;
+    }
+    *out++ = (char)value;
+    return out;
+  }
+
+  static inline const char* ReadVarInt(const char* in, SInt& value) {
+    value = 0;
+    for (SInt shift = 0;; shift += 7) {
+      unsigned char byte = *in++;
+      value |= (SInt)(byte & 0x7F) << shift;
+      if (byte < 0x80) return in;
+    }
+  }
+
+  static inline SInt ZigZag(SSInt value) {
+    return ((SInt)value << 1) ^ (SInt)(value >> 63);
+  }
+
+  static inline SSInt UnZigZag(SInt value) {
+    return (SSInt)(value >> 1) ^ -(SSInt)(value & 1);
+  }
+
+  // Encode the neighborhoods of vertices [first_vertex, end_vertex)
+  // Edges have to be sorted and duplicate-free. The offset of each vertex
+  // (v - block_origin) % block_size == 0 is appended to index, shifted by
+  // base_offset.
+  template <typename Edge>
+  static void Encode(const std::vector<Edge>& edges, SInt first_vertex,
+                     SInt end_vertex, SInt block_origin, SInt block_size,
+                     SInt base_offset, std::vector<char>& data,
+                     std::vector<SInt>& index) {
+    data.reserve(data.size() + 2 * edges.size() + (end_vertex - first_vertex));
+    auto edge = edges.begin();
+    for (SInt v = first_vertex; v < end_vertex; ++v) {
+      if ((v - block_origin) % block_size == 0)
+        index.push_back(base_offset + data.size());
+
+      auto neighbors = edge;
+      while (edge != edges.end() && EdgeSource(*edge) == v) ++edge;
+      SInt degree = edge - neighbors;
+
+      // Worst case: degree plus one varint per neighbor
+      SInt pos = data.size();
+      data.resize(pos + (degree + 1) * MAX_VARINT_BYTES);
+      char* out = WriteVarInt(&data[pos], degree);
+      SInt previous = v;
+      for (auto e = neighbors; e != edge; ++e) {
+        SInt target = EdgeTarget(*e);
+        out = (e == neighbors) ? WriteVarInt(out, ZigZag(target - previous))
+                               : WriteVarInt(out, target - previous);
+        previous = target;
+      }
+      data.resize(out - data.data());
+    }
+  }
+
+  static CompressedGraphHeader Header(SInt n, SInt m, SInt first_vertex,
+                                      SInt num_vertices, SInt block_size) {
+    CompressedGraphHeader header;
+    memcpy(header.magic, COMPRESSED_GRAPH_MAGIC, sizeof(header.magic));
+    header.n = n;
+    header.m = m;
+    header.first_vertex = first_vertex;
+    header.num_vertices = num_vertices;
+    header.block_size = block_size;
+    header.num_blocks = (num_vertices + block_size - 1) / block_size;
+    return header;
+  }
+};
+
+// Memory mapped reader for gap encoded files
+class CompressedGraph {
+ public:
+  CompressedGraph() : map_(nullptr), map_size_(0), header_(nullptr) {}
+
+  ~CompressedGraph() { Close(); }
+
+  CompressedGraph(const CompressedGraph&) = delete;
+  CompressedGraph& operator=(const CompressedGraph&) = delete;
+
+  bool Open(const std::string& filename) {
+    Close();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (SInt)st.st_size < sizeof(CompressedGraphHeader)) {
+      close(fd);
+      return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    map_ = (const char*)map;
+    map_size_ = st.st_size;
+    header_ = (const CompressedGraphHeader*)map_;
+    if (memcmp(header_->magic, COMPRESSED_GRAPH_MAGIC, sizeof(header_->magic)) != 0) {
+      Close();
+      return false;
+    }
+    index_ = (const SInt*)(map_ + sizeof(CompressedGraphHeader));
+    data_ = (const char*)(index_ + header_->num_blocks);
+    return true;
+  }
+
+  void Close() {
+    if (map_ != nullptr) munmap((void*)map_, map_size_);
+    map_ = nullptr;
+    header_ = nullptr;
+  }
+
+  SInt N() const { return header_->n; }
+
+  SInt NumEdges() const { return header_->m; }
+
+  SInt FirstVertex() const { return header_->first_vertex; }
+
+  SInt NumVertices() const { return header_->num_vertices; }
+
+  SInt Degree(SInt vertex) const {
+    SInt degree;
+    GapEncoding::ReadVarInt(Seek(vertex), degree);
+    return degree;
+  }
+
+  // Call f(target) for each neighbor of a stored vertex
+  template <typename F>
+  void ForEachNeighbor(SInt vertex, F&& f) const {
+    DecodeVertex(Seek(vertex), vertex, f);
+  }
+
+  std::vector<SInt> Neighbors(SInt vertex) const {
+    std::vector<SInt> neighbors;
+    ForEachNeighbor(vertex, [&](SInt target) { neighbors.push_back(target); });
+    return neighbors;
+  }
+
+  // Call f(source, target) for all edges in vertex order
+  template <typename F>
+  void ForEachEdge(F&& f) const {
+    const char* in = data_;
+    SInt end = FirstVertex() + NumVertices();
+    for (SInt v = FirstVertex(); v < end; ++v)
+      in = DecodeVertex(in, v, [&](SInt target) { f(v, target); });
+  }
+
+ private:
+  const char* map_;
+  SInt map_size_;
+  const CompressedGraphHeader* header_;
+  const SInt* index_;
+  const char* data_;
+
+  // Position of a vertex: jump to its block, then skip preceding vertices
+  const char* Seek(SInt vertex) const {
+    SInt local = vertex - FirstVertex();
+    const char* in = data_ + index_[local / header_->block_size];
+    for (SInt skip = local % header_->block_size; skip > 0; --skip) {
+      SInt degree, value;
+      in = GapEncoding::ReadVarInt(in, degree);
+      for (SInt i = 0; i < degree; ++i) in = GapEncoding::ReadVarInt(in, value);
+    }
+    return in;
+  }
+
+  template <typename F>
+  const char* DecodeVertex(const char* in, SInt vertex, F&& f) const {
+    SInt degree, value;
+    in = GapEncoding::ReadVarInt(in, degree);
+    SInt target = vertex;
+    for (SInt i = 0; i < degree; ++i) {
+      in = GapEncoding::ReadVarInt(in, value);
+      target = (i == 0) ? vertex + GapEncoding::UnZigZag(value) : target + value;
+      f(target);
+    }
+    return in;
+  }
+};
+
+}
+#endif
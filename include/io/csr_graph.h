@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * include/io/csr_graph.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _CSR_GRAPH_H_
+#define _CSR_GRAPH_H_
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <google/dense_hash_map>
+
+#include "definitions.h"
+#include "edge_exchange.h"
+#include "edge_types.h"
+
+namespace kagen {
+
+// Local part of a distributed graph in CSR format
+// Local vertices are numbered [0, NumLocalVertices()) in the order of their
+// global IDs, ghost vertices (remote neighbors) follow in the order of their
+// first occurrence in adjncy
+struct CSRGraph {
+  // Local ID of vertices that are neither local nor ghosts
+  static constexpr SInt INVALID_ID = std::numeric_limits<SInt>::max();
+
+  // Global IDs of the local vertices [first, second)
+  std::pair<SInt, SInt> vertex_range;
+  // Neighborhood of local vertex v is adjncy[xadj[v], xadj[v + 1])
+  std::vector<SInt> xadj;
+  // Sorted neighbors as local IDs
+  std::vector<SInt> adjncy;
+  // Global IDs of the ghost vertices
+  std::vector<SInt> ghost_to_global;
+  // Local IDs of the ghost vertices
+  google::dense_hash_map<SInt, SInt> global_to_ghost;
+
+  SInt NumLocalVertices() const { return xadj.size() - 1; }
+
+  SInt NumGhostVertices() const { return ghost_to_global.size(); }
+
+  SInt NumEdges() const { return adjncy.size(); }
+
+  SInt GlobalID(SInt local_id) const {
+    if (local_id < NumLocalVertices()) return vertex_range.first + local_id;
+    return ghost_to_global[local_id - NumLocalVertices()];
+  }
+
+  // INVALID_ID if the vertex is not adjacent to the local vertex range
+  SInt LocalID(SInt global_id) const {
+    if (global_id >= vertex_range.first && global_id < vertex_range.second)
+      return global_id - vertex_range.first;
+    auto it = global_to_ghost.find(global_id);
+    if (it == global_to_ghost.end()) return INVALID_ID;
+    return it->second;
+  }
+};
+
+// Build the CSR of the local vertex range from generated edges
+// Edges are bucketed by source with a counting sort, only the (short)
+// neighborhoods are sorted to remove duplicates. Edges of remote sources are
+// moved to their owner first, symmetrize additionally adds the reverse edges
+// for generators that emit undirected edges from one endpoint only.
+// The edge list is consumed.
+template <typename Edge>
+CSRGraph BuildCSR(std::vector<Edge>& edges,
+                  const std::pair<SInt, SInt>& vertex_range, SInt n,
+                  bool symmetrize, MPI_Comm comm = MPI_COMM_WORLD) {
+  PEID rank;
+  MPI_Comm_rank(comm, &rank);
+
+  std::vector<SInt> range_begin =
+      EdgeExchange<Edge>::VertexRanges(vertex_range, n, comm);
+  const SInt begin = range_begin[rank];
+  const SInt end = range_begin[rank + 1];
+
+  int exchange = symmetrize;
+  for (const auto& edge : edges) {
+    if (exchange) break;
+    if (EdgeSource(edge) < begin || EdgeSource(edge) >= end) exchange = 1;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &exchange, 1, MPI_INT, MPI_LOR, comm);
+  if (exchange) EdgeExchange<Edge>::Exchange(edges, range_begin, symmetrize, comm);
+
+  CSRGraph graph;
+  graph.vertex_range = std::make_pair(begin, end);
+  const SInt local_n = end - begin;
+
+  // Counting sort by source
+  graph.xadj.assign(local_n + 1, 0);
+  for (const auto& edge : edges) graph.xadj[EdgeSource(edge) - begin + 1]++;
+  for (SInt v = 0; v < local_n; ++v) graph.xadj[v + 1] += graph.xadj[v];
+
+  graph.adjncy.resize(edges.size());
+  std::vector<SInt> pos(graph.xadj.begin(), graph.xadj.end() - 1);
+  for (const auto& edge : edges)
+    graph.adjncy[pos[EdgeSource(edge) - begin]++] = EdgeTarget(edge);
+  std::vector<Edge>().swap(edges);
+  std::vector<SInt>().swap(pos);
+
+  // Sort and deduplicate neighborhoods in place
+  SInt write = 0;
+  SInt first = 0;
+  for (SInt v = 0; v < local_n; ++v) {
+    SInt last = graph.xadj[v + 1];
+    std::sort(graph.adjncy.begin() + first, graph.adjncy.begin() + last);
+    graph.xadj[v] = write;
+    for (SInt i = first; i < last; ++i) {
+      if (i == first || graph.adjncy[i] != graph.adjncy[i - 1])
+        graph.adjncy[write++] = graph.adjncy[i];
+    }
+    first = last;
+  }
+  graph.xadj[local_n] = write;
+  graph.adjncy.resize(write);
+  graph.adjncy.shrink_to_fit();
+
+  // Map neighbors to local IDs
+  graph.global_to_ghost.set_empty_key(std::numeric_limits<SInt>::max());
+  for (auto& target : graph.adjncy) {
+    if (target >= begin && target < end) {
+      target -= begin;
+      continue;
+    }
+    auto ghost = graph.global_to_ghost.find(target);
+    if (ghost == graph.global_to_ghost.end()) {
+      SInt local_id = local_n + graph.ghost_to_global.size();
+      graph.global_to_ghost[target] = local_id;
+      graph.ghost_to_global.push_back(target);
+      target = local_id;
+    } else {
+      target = ghost->second;
+    }
+  }
+  return graph;
+}
+
+}
+#endif
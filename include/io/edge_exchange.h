@@ -0,0 +1,162 @@
+/*******************************************************************************
+ * include/io/edge_exchange.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _EDGE_EXCHANGE_H_
+#define _EDGE_EXCHANGE_H_
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <climits>
+#include <utility>
+#include <vector>
+
+#include "definitions.h"
+#include "edge_types.h"
+
+namespace kagen {
+
+// Owner-based edge redistribution
+// Each edge (u, v) is sent to the PE owning u. If symmetrize is set, the
+// reverse edge (v, u) is sent to the owner of v as well. Afterwards each PE
+// holds the sorted, duplicate-free edges of its own vertex range.
+template <typename Edge>
+class EdgeExchange {
+ public:
+  // Maximum number of edges per message (MPI counts are int)
+  static constexpr SInt MAX_MESSAGE = INT_MAX;
+
+  static void Redistribute(std::vector<Edge>& edges,
+                           const std::pair<SInt, SInt>& vertex_range, SInt n,
+                           bool symmetrize, MPI_Comm comm = MPI_COMM_WORLD) {
+    Exchange(edges, VertexRanges(vertex_range, n, comm), symmetrize, comm);
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  }
+
+  // Move edges to their owners without sorting them afterwards
+  // range_begin holds the first vertex of each PE as computed by VertexRanges
+  static void Exchange(std::vector<Edge>& edges,
+                       const std::vector<SInt>& range_begin, bool symmetrize,
+                       MPI_Comm comm = MPI_COMM_WORLD) {
+    PEID size;
+    MPI_Comm_size(comm, &size);
+
+    auto owner = [&](SInt vertex) -> PEID {
+      PEID pe = std::upper_bound(range_begin.begin(), range_begin.end(), vertex) -
+                range_begin.begin() - 1;
+      return std::min(pe, size - 1);
+    };
+
+    // Bucket edges by owner
+    std::vector<SInt> send_counts(size, 0);
+    for (const auto& edge : edges) {
+      send_counts[owner(EdgeSource(edge))]++;
+      if (symmetrize) send_counts[owner(EdgeTarget(edge))]++;
+    }
+    std::vector<SInt> send_displs(size, 0);
+    for (PEID i = 1; i < size; ++i)
+      send_displs[i] = send_displs[i - 1] + send_counts[i - 1];
+
+    std::vector<Edge> send_buffer(send_displs[size - 1] + send_counts[size - 1]);
+    std::vector<SInt> pos(send_displs);
+    for (const auto& edge : edges) {
+      SInt source = EdgeSource(edge);
+      SInt target = EdgeTarget(edge);
+      send_buffer[pos[owner(source)]++] = edge;
+      if (symmetrize) send_buffer[pos[owner(target)]++] = Edge(target, source);
+    }
+    std::vector<Edge>().swap(edges);
+
+    std::vector<SInt> recv_displs;
+    Transfer(send_buffer, send_counts, edges, recv_displs, comm);
+  }
+
+  // Send send_counts[i] consecutive edges of send_buffer to PE i
+  // received holds the blocks of all PEs in PE order, the block of PE i
+  // starts at recv_displs[i]. Sparse exchange: only PEs with data are
+  // contacted, messages are split into pieces of at most INT_MAX edges.
+  static void Transfer(const std::vector<Edge>& send_buffer,
+                       const std::vector<SInt>& send_counts,
+                       std::vector<Edge>& received,
+                       std::vector<SInt>& recv_displs,
+                       MPI_Comm comm = MPI_COMM_WORLD) {
+    PEID size;
+    MPI_Comm_size(comm, &size);
+
+    std::vector<SInt> recv_counts(size, 0);
+    MPI_Alltoall(send_counts.data(), 1, MPI_UNSIGNED_LONG_LONG,
+                 recv_counts.data(), 1, MPI_UNSIGNED_LONG_LONG, comm);
+    recv_displs.assign(size, 0);
+    for (PEID i = 1; i < size; ++i)
+      recv_displs[i] = recv_displs[i - 1] + recv_counts[i - 1];
+    received.resize(recv_displs[size - 1] + recv_counts[size - 1]);
+
+    MPI_Datatype edge_type;
+    MPI_Type_contiguous(sizeof(Edge), MPI_BYTE, &edge_type);
+    MPI_Type_commit(&edge_type);
+
+    // Pieces of one message are matched in order (same source and tag)
+    std::vector<MPI_Request> requests;
+    for (PEID i = 0; i < size; ++i) {
+      for (SInt offset = 0; offset < recv_counts[i]; offset += MAX_MESSAGE) {
+        SInt piece = recv_counts[i] - offset;
+        if (piece > MAX_MESSAGE) piece = MAX_MESSAGE;
+        requests.emplace_back();
+        MPI_Irecv(received.data() + recv_displs[i] + offset, (int)piece,
+                  edge_type, i, 0, comm, &requests.back());
+      }
+    }
+    SInt send_displ = 0;
+    for (PEID i = 0; i < size; ++i) {
+      for (SInt offset = 0; offset < send_counts[i]; offset += MAX_MESSAGE) {
+        SInt piece = send_counts[i] - offset;
+        if (piece > MAX_MESSAGE) piece = MAX_MESSAGE;
+        requests.emplace_back();
+        MPI_Isend(send_buffer.data() + send_displ + offset, (int)piece,
+                  edge_type, i, 0, comm, &requests.back());
+      }
+      send_displ += send_counts[i];
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    MPI_Type_free(&edge_type);
+  }
+
+  // First vertex of each PE (plus n as sentinel)
+  // Generators report either inclusive or exclusive range ends, only
+  // overlapping ranges (e.g. Kronecker) are rejected in favor of an even
+  // block partition of [0, n)
+  static std::vector<SInt> VertexRanges(const std::pair<SInt, SInt>& vertex_range,
+                                        SInt n, MPI_Comm comm = MPI_COMM_WORLD) {
+    PEID size;
+    MPI_Comm_size(comm, &size);
+
+    SInt local_range[2] = {vertex_range.first, vertex_range.second};
+    std::vector<SInt> ranges(2 * size);
+    MPI_Allgather(local_range, 2, MPI_UNSIGNED_LONG_LONG, ranges.data(), 2,
+                  MPI_UNSIGNED_LONG_LONG, comm);
+
+    bool valid = ranges[0] == 0;
+    for (PEID i = 1; i < size; ++i) {
+      if (ranges[2 * i] < ranges[2 * (i - 1)] || ranges[2 * i] < ranges[2 * i - 1])
+        valid = false;
+    }
+
+    std::vector<SInt> range_begin(size + 1, n);
+    for (PEID i = 0; i < size; ++i) {
+      if (valid)
+        range_begin[i] = std::min(ranges[2 * i], n);
+      else
+        range_begin[i] = (SInt)((HPFloat)n * i / size);
+    }
+    return range_begin;
+  }
+};
+
+}
+#endif
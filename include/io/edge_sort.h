@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * include/io/edge_sort.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _EDGE_SORT_H_
+#define _EDGE_SORT_H_
+
+#include <mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "definitions.h"
+#include "edge_exchange.h"
+#include "edge_types.h"
+
+namespace kagen {
+
+// Distributed sample sort with duplicate removal
+// Afterwards each PE holds a sorted, duplicate-free and contiguous range of
+// the global edge sequence (PE i holds smaller edges than PE i+1)
+template <typename Edge>
+class EdgeSort {
+ public:
+  // Average number of samples per PE used for splitter selection
+  static constexpr SInt OVERSAMPLING = 16;
+
+  static void SortUnique(std::vector<Edge>& edges, MPI_Comm comm = MPI_COMM_WORLD) {
+    PEID size;
+    MPI_Comm_size(comm, &size);
+
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    if (size == 1) return;
+
+    MPI_Datatype edge_type;
+    MPI_Type_contiguous(sizeof(Edge), MPI_BYTE, &edge_type);
+    MPI_Type_commit(&edge_type);
+
+    std::vector<Edge> splitters = SelectSplitters(edges, size, edge_type, comm);
+    MPI_Type_free(&edge_type);
+
+    // Partition sorted local edges by splitters
+    // Equal edges always end up on the same PE, so no duplicates remain
+    // across PE boundaries after the local deduplication below
+    std::vector<SInt> send_counts(size, 0);
+    auto begin = edges.begin();
+    for (PEID i = 0; i < size; ++i) {
+      auto end = (i + 1 < size)
+                     ? std::upper_bound(begin, edges.end(), splitters[i])
+                     : edges.end();
+      send_counts[i] = end - begin;
+      begin = end;
+    }
+
+    // Per-PE counts may exceed the range of int
+    std::vector<Edge> received;
+    std::vector<SInt> recv_displs;
+    EdgeExchange<Edge>::Transfer(edges, send_counts, received, recv_displs,
+                                 comm);
+
+    // Received blocks are sorted runs, merge them pairwise
+    for (PEID width = 1; width < size; width *= 2) {
+      for (PEID i = 0; i + width < size; i += 2 * width) {
+        auto first = received.begin() + recv_displs[i];
+        auto middle = received.begin() + recv_displs[i + width];
+        auto last = (i + 2 * width < size)
+                        ? received.begin() + recv_displs[i + 2 * width]
+                        : received.end();
+        std::inplace_merge(first, middle, last);
+      }
+    }
+    received.erase(std::unique(received.begin(), received.end()), received.end());
+    edges.swap(received);
+  }
+
+ private:
+  // Regular sampling on each PE, splitters are chosen from all samples
+  // The number of samples is proportional to the local number of edges
+  static std::vector<Edge> SelectSplitters(const std::vector<Edge>& edges,
+                                           PEID size, MPI_Datatype edge_type,
+                                           MPI_Comm comm) {
+    SInt local_edges = edges.size();
+    SInt total_edges = 0;
+    MPI_Allreduce(&local_edges, &total_edges, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, comm);
+    SInt num_samples = 0;
+    if (total_edges > 0) {
+      HPFloat share = (HPFloat)local_edges / total_edges;
+      num_samples = std::min(local_edges,
+                             (SInt)std::ceil(share * OVERSAMPLING * size));
+    }
+
+    std::vector<Edge> samples;
+    for (SInt i = 0; i < num_samples; ++i)
+      samples.push_back(edges[(i * edges.size() + edges.size() / 2) / num_samples]);
+
+    // At most OVERSAMPLING + 1 samples per PE on average, so the sample
+    // counts and displacements fit into int
+    int local_samples = samples.size();
+    std::vector<int> sample_counts(size), sample_displs(size, 0);
+    MPI_Allgather(&local_samples, 1, MPI_INT, sample_counts.data(), 1, MPI_INT,
+                  comm);
+    for (PEID i = 1; i < size; ++i)
+      sample_displs[i] = sample_displs[i - 1] + sample_counts[i - 1];
+
+    std::vector<Edge> global_samples(sample_displs[size - 1] +
+                                     sample_counts[size - 1]);
+    MPI_Allgatherv(samples.data(), local_samples, edge_type,
+                   global_samples.data(), sample_counts.data(),
+                   sample_displs.data(), edge_type, comm);
+    std::sort(global_samples.begin(), global_samples.end());
+
+    // No samples at all: everything stays in place (all PEs are empty)
+    std::vector<Edge> splitters(size - 1);
+    if (global_samples.empty()) return splitters;
+    for (PEID i = 0; i < size - 1; ++i)
+      splitters[i] = global_samples[(i + 1) * global_samples.size() / size];
+    return splitters;
+  }
+};
+
+}
+#endif
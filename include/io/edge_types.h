@@ -0,0 +1,85 @@
+/*******************************************************************************
+ * include/io/edge_types.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _EDGE_TYPES_H_
+#define _EDGE_TYPES_H_
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Edge storage types
+// Generators store edges in the narrowest type that holds all vertex IDs
+typedef std::tuple<SInt, SInt> Edge64;
+typedef std::tuple<UINT, UINT> Edge32;
+
+// 48 bit vertex IDs in 12 bytes (generalized Graph500 packed_edge)
+struct PackedEdge48 {
+  uint32_t v0_low;
+  uint32_t v1_low;
+  uint32_t high;  // v1 in high half, v0 in low half
+
+  PackedEdge48() = default;
+
+  PackedEdge48(SInt source, SInt target)
+      : v0_low((uint32_t)source),
+        v1_low((uint32_t)target),
+        high((uint32_t)(((source >> 32) & 0xFFFF) |
+                        (((target >> 32) & 0xFFFF) << 16))) {}
+
+  SInt Source() const { return v0_low | ((SInt)(high & 0xFFFF) << 32); }
+
+  SInt Target() const { return v1_low | ((SInt)(high >> 16) << 32); }
+
+  bool operator<(const PackedEdge48& other) const {
+    return Source() < other.Source() ||
+           (Source() == other.Source() && Target() < other.Target());
+  }
+
+  bool operator==(const PackedEdge48& other) const {
+    return v0_low == other.v0_low && v1_low == other.v1_low &&
+           high == other.high;
+  }
+
+  bool operator!=(const PackedEdge48& other) const { return !(*this == other); }
+};
+
+// Endpoints of an edge
+template <typename T>
+inline SInt EdgeSource(const std::tuple<T, T>& edge) { return std::get<0>(edge); }
+
+template <typename T>
+inline SInt EdgeTarget(const std::tuple<T, T>& edge) { return std::get<1>(edge); }
+
+template <typename T>
+inline SInt EdgeSource(const std::pair<T, T>& edge) { return edge.first; }
+
+template <typename T>
+inline SInt EdgeTarget(const std::pair<T, T>& edge) { return edge.second; }
+
+inline SInt EdgeSource(const PackedEdge48& edge) { return edge.Source(); }
+
+inline SInt EdgeTarget(const PackedEdge48& edge) { return edge.Target(); }
+
+// Edge list types (as opposed to adjacency lists)
+template <typename T>
+struct IsEdge : std::false_type {};
+
+template <typename T>
+struct IsEdge<std::tuple<T, T>> : std::is_integral<T> {};
+
+template <>
+struct IsEdge<PackedEdge48> : std::true_type {};
+
+}
+#endif
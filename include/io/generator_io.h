@@ -13,184 +13,568 @@
 #include <mpi.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <numeric>
+#include <string>
 #include <tuple>
 #include <type_traits>
 #include <vector>
 
+#include "async_writer.h"
+#include "chunk_parallel.h"
+#include "compressed_graph.h"
+#include "edge_exchange.h"
+#include "edge_sort.h"
+#include "edge_types.h"
 #include "generator_config.h"
+#include "output_format.h"
+#include "text_format.h"
 
 namespace kagen {
 
-template <typename T>
-struct identity {
-  typedef T type;
-};
-
-template <typename Edge = std::tuple<SInt, SInt>>
+template <typename Edge = Edge64>
 class GeneratorIO {
  public:
-  GeneratorIO(PGeneratorConfig& config) : config_(config), local_num_edges_(0) {
-    dist_.resize(config_.dist_size);
+  GeneratorIO(PGeneratorConfig& config)
+      : config_(config), local_num_edges_(0), flushed_edges_(0), stream_(nullptr) {
+    if (!ParseOutputFormat(config_.output_format, format_))
+      format_ = OutputFormat::NONE;
+    store_edges_ = format_ != OutputFormat::DIST && format_ != OutputFormat::NONE;
+    if (format_ == OutputFormat::DIST) dist_.resize(config_.dist_size);
+
+    // Streaming is only supported for plain edge lists
+    // Global sorting and redistribution require all edges in memory
+    buffer_limit_ = 0;
+    if (IsEdge<Edge>::value && format_ != OutputFormat::COMPRESSED &&
+        !config_.sort_edges && !config_.redistribute)
+      buffer_limit_ = (config_.buffer_mb << 20) / sizeof(Edge);
+    flush_limit_ = NO_LIMIT;
+    if (buffer_limit_ > 0) flush_limit_ = buffer_limit_;
   }
 
-  inline void UpdateDist(SInt node_id) {
-    // if ((CRCHash::hash(node_id) % config_.n) < dist_.size()) dist_[node_id]++;
-    if (node_id < dist_.size()) dist_[node_id]++;
-    local_num_edges_++;
+  ~GeneratorIO() {
+    if (stream_ != nullptr) fclose(stream_);
   }
 
-  void OutputDist() const {
-    // Exchange local dist
-    PEID rank, size;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
-    std::vector<SInt> global_dist(dist_.size(), 0);
-    MPI_Reduce(&dist_[0], &global_dist[0], dist_.size(), MPI_LONG, MPI_SUM,
-               ROOT, MPI_COMM_WORLD);
-    if (rank == ROOT) {
-      FILE* fout = fopen(config_.output_file.c_str(), "w+");
-      for (SInt i = 0; i < global_dist.size(); ++i) {
-        fprintf(fout, "%llu\n", global_dist[i]);
+  void ReserveEdges(SInt num_edges) {
+    if (buffer_limit_ > 0) num_edges = std::min(num_edges, buffer_limit_);
+    if (store_edges_) edges_.reserve(num_edges);
+  }
+
+  // Thread local instances keep all edges in memory until they are appended
+  void DisableStreaming() {
+    buffer_limit_ = 0;
+    flush_limit_ = NO_LIMIT;
+  }
+
+  // Move the edges of thread local instances behind the own edges
+  // Without streaming, the blocks are copied in parallel at their prefix
+  // sum offsets; a streaming target takes them edge by edge to flush in time
+  void Append(const std::vector<GeneratorIO*>& others, SInt threads) {
+    for (GeneratorIO* other : others) {
+      local_num_edges_ += other->local_num_edges_;
+      other->local_num_edges_ = 0;
+      for (SInt i = 0; i < std::min(dist_.size(), other->dist_.size()); ++i)
+        dist_[i] += other->dist_[i];
+    }
+    if (!store_edges_) return;
+
+    if (buffer_limit_ > 0) {
+      for (GeneratorIO* other : others) {
+        for (const Edge& edge : other->edges_) {
+          edges_.push_back(edge);
+          if (edges_.size() >= buffer_limit_) FlushEdges();
+        }
+        std::vector<Edge>().swap(other->edges_);
       }
-      fclose(fout);
+      return;
     }
-  }
 
-  void ReserveEdges(SInt num_edges) { edges_.reserve(num_edges); }
+    std::vector<SInt> offsets(others.size() + 1, edges_.size());
+    for (SInt i = 0; i < others.size(); ++i)
+      offsets[i + 1] = offsets[i] + others[i]->edges_.size();
+    edges_.resize(offsets.back());
+    ParallelChunks(threads, 0, others.size(),
+                   [&](SInt, SInt begin, SInt end) {
+                     for (SInt i = begin; i < end; ++i) {
+                       std::vector<Edge>& block = others[i]->edges_;
+                       std::copy(block.begin(), block.end(),
+                                 edges_.begin() + offsets[i]);
+                       std::vector<Edge>().swap(block);
+                     }
+                   });
+  }
 
+  // Stored edges take one (predictable) branch on the sink and one
+  // comparison against the flush limit, which is unreachable without
+  // streaming; the "none" sink only counts the edge
   template <typename... Args>
   inline void PushEdge(Args... args) {
-    edges_.emplace_back(std::make_tuple(args...));
     local_num_edges_++;
+    if (store_edges_) {
+      edges_.emplace_back(args...);
+      if (edges_.size() >= flush_limit_) FlushEdges();
+    } else if (format_ == OutputFormat::DIST) {
+      UpdateDist(args...);
+    }
   }
 
-  void OutputEdges() const { 
-#ifdef SINGLE_LIST
-    GatherPrint(identity<Edge>());
-#else
-    Print(identity<Edge>()); 
-#endif
+  void Output() {
+    switch (format_) {
+      case OutputFormat::DIMACS:
+        OutputEdges<DimacsWriter>();
+        break;
+      case OutputFormat::EDGE_LIST:
+        OutputEdges<EdgeListWriter>();
+        break;
+      case OutputFormat::BINARY:
+        OutputEdges<BinaryWriter>();
+        break;
+      case OutputFormat::BINARY32:
+        OutputEdges<Binary32Writer>();
+        break;
+      case OutputFormat::DIST:
+        OutputDist();
+        break;
+      // Adjacency output needs the vertex range
+      case OutputFormat::COMPRESSED:
+      case OutputFormat::NONE:
+        break;
+    }
   }
 
-  SInt NumEdges() const { 
-    return edges_.size() > 0 ? edges_.size() : local_num_edges_/2; 
+  // Output with optional redistribution of edges to the owner of their
+  // source vertex, undirected graphs also receive missing reverse edges
+  void Output(const std::pair<SInt, SInt>& vertex_range, bool directed = false) {
+    if (format_ == OutputFormat::COMPRESSED) {
+      OutputCompressed(IsEdge<Edge>(), vertex_range, !directed);
+      return;
+    }
+    if (config_.redistribute && store_edges_)
+      Redistribute(IsEdge<Edge>(), vertex_range, !directed);
+    Output();
   }
 
+  SInt NumEdges() const { return local_num_edges_; }
+
  private:
   PGeneratorConfig &config_;
+  OutputFormat format_;
+  bool store_edges_;
 
   std::vector<SInt> dist_;
   std::vector<Edge> edges_;
 
   SInt local_num_edges_;
 
-  void GatherPrint(identity<std::tuple<SInt, SInt>>) const {
+  // Streaming output (edges are flushed once the buffer limit is reached)
+  SInt buffer_limit_;
+  // buffer_limit_, or NO_LIMIT if edges are not streamed
+  SInt flush_limit_;
+  SInt flushed_edges_;
+  FILE* stream_;
+  // Number of edges of each sorted run in the spill file
+  std::vector<SInt> spill_runs_;
+  std::unique_ptr<AsyncWriter> writer_;
+
+  static constexpr SInt NO_LIMIT = std::numeric_limits<SInt>::max();
+  // Buffer size for collective output
+  static constexpr SInt WRITE_BUFFER_SIZE = (SInt)1 << 24;
+  // Vertices per block of the compressed adjacency index
+  static constexpr SInt COMPRESSED_BLOCK_SIZE = 64;
+
+  // Count source vertex of an edge
+  template <typename... Args>
+  inline void UpdateDist(SInt node_id, Args...) {
+    // if ((CRCHash::hash(node_id) % config_.n) < dist_.size()) dist_[node_id]++;
+    if (node_id < dist_.size()) dist_[node_id]++;
+  }
+
+  void OutputDist() const {
     // Exchange local dist
     PEID rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-    // Gather number of edges for each PE
-    std::vector<int> displ(size);
-    std::vector<int> num_edges(size);
-    int lSize = NumEdges();
-    MPI_Gather(&lSize, 1, MPI_INT,
-               num_edges.data(), 1, MPI_INT, 
+    std::vector<SInt> global_dist(dist_.size(), 0);
+    MPI_Reduce(&dist_[0], &global_dist[0], dist_.size(), MPI_LONG, MPI_SUM,
                ROOT, MPI_COMM_WORLD);
-    int current_displ = 0;
-    int total_num_edges = 0;
     if (rank == ROOT) {
-      for (SInt i = 0; i < num_edges.size(); ++i) {
-        displ[i] = current_displ;
-        total_num_edges += num_edges[i];
-        current_displ = total_num_edges;
+      FILE* fout = fopen(config_.output_file.c_str(), "w+");
+      for (SInt i = 0; i < global_dist.size(); ++i) {
+        fprintf(fout, "%llu\n", global_dist[i]);
       }
+      fclose(fout);
     }
+  }
 
-    // Gather actual edges
-    MPI_Datatype MPI_EDGE;
-    MPI_Type_vector(1, 2, 0, MPI_LONG, &MPI_EDGE);
-    MPI_Type_commit(&MPI_EDGE);
-    std::vector<Edge> edges(total_num_edges);
-    MPI_Gatherv(edges_.data(), lSize, MPI_EDGE,
-                edges.data(), num_edges.data(), displ.data(), MPI_EDGE, 
-                ROOT, MPI_COMM_WORLD);
+  template <typename Writer>
+  void OutputEdges() {
+    // Redistributed edges are already globally sorted by source
+    if (config_.sort_edges && !config_.redistribute) SortEdges(IsEdge<Edge>());
+    if (config_.single_file)
+      CollectivePrint<Writer>(IsEdge<Edge>());
+    else
+      Print<Writer>(IsEdge<Edge>());
+  }
 
+  void SortEdges(std::false_type) {}
 
-    if (rank == ROOT) {
-      // Sort edges and remove duplicates
-      std::sort(std::begin(edges), std::end(edges));
-      SInt total_edges = edges.size();
-      edges.erase(unique(edges.begin(), edges.end()), edges.end());
-      
-#ifndef BINARY_OUT
-      // Output edges
-      FILE* fout = fopen(config_.output_file.c_str(), "w+");
-#ifndef OMIT_HEADER
-      fprintf(fout, "p %llu %lu\n", config_.n, edges.size());
-#endif
-      for (auto edge : edges) fprintf(fout, "e %llu %llu\n", std::get<0>(edge) + 1, std::get<1>(edge) + 1);
-#else
-      FILE* fout =
-          fopen(config_.output_file.c_str(), "wb+");
-#ifndef OMIT_HEADER
-      SInt total_m = edges.size();
-      fwrite(&config_.n, sizeof(SInt), 1, fout);
-      fwrite(&total_m, sizeof(SInt), 1, fout);
-#endif
-      for (auto edge : edges) {
-        SInt source = std::get<0>(edge) + 1;
-        SInt target = std::get<1>(edge) + 1;
-        fwrite(&source, sizeof(SInt), 1, fout);
-        fwrite(&target, sizeof(SInt), 1, fout);
-      }
-#endif
-      fclose(fout);
-    }
+  void SortEdges(std::true_type) { EdgeSort<Edge>::SortUnique(edges_); }
+
+  void Redistribute(std::false_type, const std::pair<SInt, SInt>&, bool) {}
+
+  void Redistribute(std::true_type, const std::pair<SInt, SInt>& vertex_range,
+                    bool symmetrize) {
+    EdgeExchange<Edge>::Redistribute(edges_, vertex_range, config_.n, symmetrize);
   }
 
-  // node id output
-  void Print(identity<std::tuple<SInt, SInt>>) const {
+  // Adjacency lists are always written per PE
+  template <typename Writer>
+  void CollectivePrint(std::false_type) {
+    Print<Writer>(std::false_type());
+  }
+
+  // Collective single file output
+  // Each PE computes the byte offset of its slice with an exclusive prefix sum
+  // and writes it to the shared file via MPI-IO
+  template <typename Writer>
+  void CollectivePrint(std::true_type) {
     PEID rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
 
+    // Sort edges and remove local duplicates
+    // Spilled edges are sorted runs that are merged on the fly, so the output
+    // does not depend on the buffer limit
+    if (stream_ == nullptr) {
+      std::sort(std::begin(edges_), std::end(edges_));
+      edges_.erase(std::unique(edges_.begin(), edges_.end()), edges_.end());
+    } else {
+      FlushEdges();
+    }
+
+    // Compute size of local slice
+    SInt num_edges = 0;
+    SInt edge_bytes = 0;
+    ForEachEdge([&](const Edge& edge) {
+      num_edges++;
+      edge_bytes += Writer::EdgeBytes(EdgeSource(edge), EdgeTarget(edge));
+    });
+    SInt total_num_edges = 0;
+    MPI_Allreduce(&num_edges, &total_num_edges, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, MPI_COMM_WORLD);
+
+    // Header is written by ROOT in front of its own slice
+    std::string header;
+    if (rank == ROOT && !config_.omit_header)
+      header = Writer::Header(config_.n, total_num_edges, false);
+
+    // Compute offset of local slice
+    SInt local_bytes = header.size() + edge_bytes;
+    SInt offset = 0;
+    MPI_Exscan(&local_bytes, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+               MPI_COMM_WORLD);
+    if (rank == ROOT) offset = 0;
+
+    MPI_File fout;
+    MPI_File_open(MPI_COMM_WORLD, config_.output_file.c_str(),
+                  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fout);
+    MPI_File_set_size(fout, 0);
+
+    // Write slice in rounds of bounded size
+    SInt num_rounds = 0;
+    SInt local_rounds =
+        (local_bytes + WRITE_BUFFER_SIZE - Writer::MAX_EDGE_BYTES - 1) /
+        (WRITE_BUFFER_SIZE - Writer::MAX_EDGE_BYTES);
+    MPI_Allreduce(&local_rounds, &num_rounds, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_MAX, MPI_COMM_WORLD);
+
+    std::vector<char> buffer(WRITE_BUFFER_SIZE);
+    memcpy(buffer.data(), header.data(), header.size());
+    char* pos = buffer.data() + header.size();
+    char* const limit = buffer.data() + WRITE_BUFFER_SIZE - Writer::MAX_EDGE_BYTES;
+    SInt current_round = 0;
+    auto write_round = [&]() {
+      SInt length = pos - buffer.data();
+      MPI_File_write_at_all(fout, offset, buffer.data(), length, MPI_CHAR,
+                            MPI_STATUS_IGNORE);
+      offset += length;
+      pos = buffer.data();
+      current_round++;
+    };
+    ForEachEdge([&](const Edge& edge) {
+      if (pos > limit) write_round();
+      pos = Writer::WriteEdge(pos, EdgeSource(edge), EdgeTarget(edge));
+    });
+    while (current_round < num_rounds) write_round();
+    MPI_File_close(&fout);
+
+    // Remove spill file
+    if (stream_ != nullptr) {
+      fclose(stream_);
+      stream_ = nullptr;
+      spill_runs_.clear();
+      remove(SpillFile().c_str());
+    }
+  }
+
+  void OutputCompressed(std::false_type, const std::pair<SInt, SInt>&, bool) {}
+
+  // Gap encoded adjacency lists
+  // Edges are moved to the owner of their source first, so every PE encodes
+  // the complete neighborhoods of its own vertex range
+  void OutputCompressed(std::true_type, const std::pair<SInt, SInt>& vertex_range,
+                        bool symmetrize) {
+    PEID rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    std::vector<SInt> range_begin =
+        EdgeExchange<Edge>::VertexRanges(vertex_range, config_.n);
+    EdgeExchange<Edge>::Exchange(edges_, range_begin, symmetrize);
+    std::sort(edges_.begin(), edges_.end());
+    edges_.erase(std::unique(edges_.begin(), edges_.end()), edges_.end());
+    const SInt begin = range_begin[rank];
+    const SInt end = range_begin[rank + 1];
+
     SInt num_edges = edges_.size();
     SInt total_num_edges = 0;
+    MPI_Allreduce(&num_edges, &total_num_edges, 1, MPI_UNSIGNED_LONG_LONG,
+                  MPI_SUM, MPI_COMM_WORLD);
+
+    // Index blocks start at the first vertex of the file
+    SInt first_vertex = config_.single_file ? 0 : begin;
+    std::vector<char> data;
+    std::vector<SInt> index;
+    GapEncoding::Encode(edges_, begin, end, first_vertex, COMPRESSED_BLOCK_SIZE,
+                        0, data, index);
+    std::vector<Edge>().swap(edges_);
+
+    if (!config_.single_file) {
+      CompressedGraphHeader header =
+          GapEncoding::Header(config_.n, num_edges, begin, end - begin,
+                              COMPRESSED_BLOCK_SIZE);
+      AsyncWriter writer(OutputFile(), config_.direct_io);
+      writer.Write((const char*)&header, sizeof(header));
+      writer.Write((const char*)index.data(), index.size() * sizeof(SInt));
+      writer.Write(data.data(), data.size());
+      CloseOutput(writer);
+      return;
+    }
+
+    // Single file: data offsets follow from a prefix sum over encoded sizes,
+    // index entries of blocks starting in the local range are contiguous
+    SInt local_bytes = data.size();
+    SInt data_offset = 0;
+    MPI_Exscan(&local_bytes, &data_offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+               MPI_COMM_WORLD);
+    if (rank == ROOT) data_offset = 0;
+    for (auto& offset : index) offset += data_offset;
+
+    CompressedGraphHeader header = GapEncoding::Header(
+        config_.n, total_num_edges, 0, config_.n, COMPRESSED_BLOCK_SIZE);
+    SInt first_block = (begin + COMPRESSED_BLOCK_SIZE - 1) / COMPRESSED_BLOCK_SIZE;
+    SInt index_start = sizeof(header) + first_block * sizeof(SInt);
+    SInt data_start = sizeof(header) + header.num_blocks * sizeof(SInt);
+
+    MPI_File fout;
+    MPI_File_open(MPI_COMM_WORLD, config_.output_file.c_str(),
+                  MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fout);
+    MPI_File_set_size(fout, 0);
+    if (rank == ROOT) WriteAt(fout, 0, (const char*)&header, sizeof(header));
+    WriteAt(fout, index_start, (const char*)index.data(),
+            index.size() * sizeof(SInt));
+    WriteAt(fout, data_start + data_offset, data.data(), data.size());
+    MPI_File_close(&fout);
+  }
+
+  // Independent write in pieces of bounded size
+  void WriteAt(MPI_File fout, SInt offset, const char* data, SInt size) const {
+    for (SInt written = 0; written < size; written += WRITE_BUFFER_SIZE) {
+      SInt length = size - written;
+      if (length > WRITE_BUFFER_SIZE) length = WRITE_BUFFER_SIZE;
+      MPI_File_write_at(fout, offset + written, data + written, length,
+                        MPI_CHAR, MPI_STATUS_IGNORE);
+    }
+  }
+
+  // Iterate over spilled or buffered edges
+  // Spilled runs are merged in ascending order without duplicates, every run
+  // is read back in batches into its own slice of the (flushed) edge buffer
+  template <typename F>
+  void ForEachEdge(F&& callback) {
+    if (stream_ == nullptr) {
+      for (const auto& edge : edges_) callback(edge);
+      return;
+    }
+
+    const SInt num_runs = spill_runs_.size();
+    const SInt batch = std::max(buffer_limit_ / std::max(num_runs, (SInt)1), (SInt)1);
+    edges_.resize(num_runs * batch);
+    std::vector<SInt> file_pos(num_runs), remaining(spill_runs_);
+    std::vector<SInt> pos(num_runs), end(num_runs);
+    auto refill = [&](SInt run) {
+      SInt count = std::min(remaining[run], batch);
+      fseeko(stream_, (off_t)(file_pos[run] * sizeof(Edge)), SEEK_SET);
+      count = fread(edges_.data() + run * batch, sizeof(Edge), count, stream_);
+      file_pos[run] += count;
+      remaining[run] -= count;
+      pos[run] = run * batch;
+      end[run] = run * batch + count;
+    };
+
+    // Min-heap of runs by their current edge
+    auto greater = [&](SInt a, SInt b) { return edges_[pos[b]] < edges_[pos[a]]; };
+    std::vector<SInt> heap;
+    SInt run_begin = 0;
+    for (SInt run = 0; run < num_runs; ++run) {
+      file_pos[run] = run_begin;
+      run_begin += spill_runs_[run];
+      refill(run);
+      if (pos[run] < end[run]) heap.push_back(run);
+    }
+    std::make_heap(heap.begin(), heap.end(), greater);
+
+    bool first = true;
+    Edge last = Edge();
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), greater);
+      SInt run = heap.back();
+      Edge edge = edges_[pos[run]++];
+      if (first || !(edge == last)) callback(edge);
+      first = false;
+      last = edge;
+      if (pos[run] == end[run]) refill(run);
+      if (pos[run] < end[run])
+        std::push_heap(heap.begin(), heap.end(), greater);
+      else
+        heap.pop_back();
+    }
+    edges_.clear();
+  }
+
+  // node id output
+  template <typename Writer>
+  void Print(std::true_type) {
+    SInt num_edges = edges_.size() + flushed_edges_;
+    SInt total_num_edges = 0;
     MPI_Allreduce(&num_edges, &total_num_edges, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
 
-#ifndef BINARY_OUT
-    FILE* fout =
-        fopen((config_.output_file + "_" + std::to_string(rank)).c_str(), "w+");
-#ifndef OMIT_HEADER
-    fprintf(fout, "p %llu %lu\n", config_.n, total_num_edges);
-#endif
-    for (auto edge : edges_) {
-      fprintf(fout, "e %llu %llu\n", std::get<0>(edge) + 1, std::get<1>(edge) + 1);
-    }
-#else
-    FILE* fout =
-        fopen((config_.output_file + "_" + std::to_string(rank)).c_str(), "wb+");
-#ifndef OMIT_HEADER
-    SInt total_m = total_num_edges;
-    fwrite(&config_.n, sizeof(SInt), 1, fout);
-    fwrite(&total_m, sizeof(SInt), 1, fout);
-#endif
-    for (auto edge : edges_) {
-      SInt source = std::get<0>(edge) + 1;
-      SInt target = std::get<1>(edge) + 1;
-      fwrite(&source, sizeof(SInt), 1, fout);
-      fwrite(&target, sizeof(SInt), 1, fout);
+    // Streamed output: write remaining edges and fill in header
+    if (writer_) {
+      FlushEdges();
+      CloseOutput(*writer_);
+      writer_.reset();
+      std::string header = Writer::Header(config_.n, total_num_edges, true);
+      if (!config_.omit_header && !header.empty()) {
+        FILE* fout = fopen(OutputFile().c_str(), "r+b");
+        if (fout == nullptr) Fail("Could not open " + OutputFile() + ": " + strerror(errno));
+        bool written = fwrite(header.data(), 1, header.size(), fout) == header.size();
+        if (fclose(fout) != 0 || !written) Fail("Could not write header");
+      }
+      return;
     }
-#endif
-    fclose(fout);
+
+    AsyncWriter writer(OutputFile(), config_.direct_io);
+    if (!config_.omit_header) {
+      std::string header = Writer::Header(config_.n, total_num_edges, false);
+      writer.Write(header.data(), header.size());
+    }
+    WriteEdges<Writer>(writer);
+    CloseOutput(writer);
   };
 
+  void FlushEdges() { FlushEdges(IsEdge<Edge>()); }
+
+  // Streaming is not supported for adjacency lists
+  void FlushEdges(std::false_type) {}
+
+  // Write buffered edges to disk and clear the buffer
+  // Edges go to the per-PE output file (in generation order) or, for a
+  // single edge list, to a per-PE spill file as a sorted, duplicate-free run
+  // that is merged with the other runs during the collective output
+  void FlushEdges(std::true_type) {
+    if (config_.single_file) {
+      std::sort(edges_.begin(), edges_.end());
+      edges_.erase(std::unique(edges_.begin(), edges_.end()), edges_.end());
+      if (stream_ == nullptr) stream_ = fopen(SpillFile().c_str(), "wb+");
+      if (stream_ == nullptr) Fail("Could not open " + SpillFile() + ": " + strerror(errno));
+      fseeko(stream_, 0, SEEK_END);
+      fwrite(edges_.data(), sizeof(Edge), edges_.size(), stream_);
+      spill_runs_.push_back(edges_.size());
+    } else {
+      switch (format_) {
+        case OutputFormat::DIMACS:
+          StreamEdges<DimacsWriter>();
+          break;
+        case OutputFormat::EDGE_LIST:
+          StreamEdges<EdgeListWriter>();
+          break;
+        case OutputFormat::BINARY:
+          StreamEdges<BinaryWriter>();
+          break;
+        case OutputFormat::BINARY32:
+          StreamEdges<Binary32Writer>();
+          break;
+        default:
+          break;
+      }
+    }
+    flushed_edges_ += edges_.size();
+    edges_.clear();
+  }
+
+  template <typename Writer>
+  void StreamEdges() {
+    if (!writer_) {
+      writer_.reset(new AsyncWriter(OutputFile(), config_.direct_io));
+      if (!config_.omit_header) {
+        // Placeholder, the edge count is filled in on output
+        std::string header = Writer::Header(config_.n, 0, true);
+        writer_->Write(header.data(), header.size());
+      }
+    }
+    WriteEdges<Writer>(*writer_);
+  }
+
+  // A failed write leaves a truncated file, so the run fails as a whole
+  static void CloseOutput(AsyncWriter& writer) {
+    if (!writer.Close()) Fail("Could not write output");
+  }
+
+  static void Fail(const std::string& message) {
+    std::cerr << message << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  std::string OutputFile() const {
+    PEID rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return config_.output_file + "_" + std::to_string(rank);
+  }
+
+  std::string SpillFile() const {
+    PEID rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    return config_.output_file + "_spill_" + std::to_string(rank);
+  }
+
+  template <typename Writer>
+  void WriteEdges(AsyncWriter& writer) const {
+    for (const auto& edge : edges_) {
+      char* out = writer.Reserve(Writer::MAX_EDGE_BYTES);
+      writer.Commit(Writer::WriteEdge(out, EdgeSource(edge), EdgeTarget(edge)) - out);
+    }
+  }
+
   // ABUSE: adjacency list output
-  void Print(identity<std::tuple<SInt, std::vector<SInt>>>) const {
+  template <typename Writer>
+  void Print(std::false_type) const {
     PEID rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -210,24 +594,32 @@ class GeneratorIO {
         std::begin(nodes), std::end(nodes), SInt(0),
         [](SInt a, const Edge& b) { return a + std::get<1>(b).size(); });
 
-    FILE* fout =
-        fopen((config_.output_file + std::to_string(rank)).c_str(), "wb");
-    fprintf(fout, "%lu %llu\n", edges_.size(), edgeCount);
+    AsyncWriter writer(config_.output_file + std::to_string(rank),
+                       config_.direct_io);
+    char* header = writer.Reserve(TextFormat::MAX_EDGE_LIST_BYTES);
+    writer.Commit(TextFormat::WriteEdgeListEdge(header, edges_.size(), edgeCount) - header);
 
     for (auto& node : nodes) {
       auto& edges = std::get<1>(node);
-      edgeCount += edges.size();
       std::sort(std::begin(edges), std::end(edges));
 
-      std::string sep = "";
-      for (const auto& edge : edges) {
-        fprintf(fout, "%s%llu", sep.c_str(), edge);
-        sep = " ";
+      // Long adjacency lists are written in pieces
+      const SInt max_neighbors =
+          (writer.BufferSize() - 1) / (TextFormat::MAX_UINT_BYTES + 1);
+      const SInt* begin = edges.data();
+      const SInt* end = edges.data() + edges.size();
+      while (end - begin > (SSInt)max_neighbors) {
+        char* line = writer.Reserve(writer.BufferSize());
+        char* line_end = TextFormat::WriteMetisLine(line, begin, begin + max_neighbors);
+        *(line_end - 1) = ' ';
+        writer.Commit(line_end - line);
+        begin += max_neighbors;
       }
-      fprintf(fout, "\n");
+      char* line = writer.Reserve((end - begin) * (TextFormat::MAX_UINT_BYTES + 1) + 1);
+      writer.Commit(TextFormat::WriteMetisLine(line, begin, end) - line);
     }
 
-    fclose(fout);
+    CloseOutput(writer);
   };
 };
 
@@ -0,0 +1,134 @@
+/*******************************************************************************
+ * include/io/output_format.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _OUTPUT_FORMAT_H_
+#define _OUTPUT_FORMAT_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "definitions.h"
+#include "text_format.h"
+
+namespace kagen {
+
+enum class OutputFormat {
+  DIMACS,
+  EDGE_LIST,
+  BINARY,
+  BINARY32,
+  COMPRESSED,
+  DIST,
+  NONE
+};
+
+struct OutputFormatEntry {
+  const char* name;
+  OutputFormat format;
+  const char* description;
+};
+
+// Formats selectable with -format
+inline const std::vector<OutputFormatEntry>& OutputFormats() {
+  static const std::vector<OutputFormatEntry> formats = {
+      {"dimacs", OutputFormat::DIMACS, "DIMACS text (p n m / e u v, 1-based)"},
+      {"edgelist", OutputFormat::EDGE_LIST, "plain text edge list (u v, 0-based)"},
+      {"binary", OutputFormat::BINARY, "binary 64 bit (n, m, u v ..., 1-based)"},
+      {"binary32", OutputFormat::BINARY32, "binary 32 bit IDs (64 bit n, m, 32 bit u v ..., 1-based, n < 2^32)"},
+      {"compressed", OutputFormat::COMPRESSED, "gap/varint encoded adjacency lists with block index"},
+      {"dist", OutputFormat::DIST, "degree histogram of the first -dist vertices"},
+      {"none", OutputFormat::NONE, "no output (generation only)"}};
+  return formats;
+}
+
+inline bool ParseOutputFormat(const std::string& name, OutputFormat& format) {
+  for (const auto& entry : OutputFormats()) {
+    if (name == entry.name) {
+      format = entry.format;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Edge list writers
+// Each writer formats single edges into a raw buffer and is selected once per
+// output call, so the per-edge path is resolved at compile time
+struct DimacsWriter {
+  static constexpr SInt MAX_EDGE_BYTES = TextFormat::MAX_DIMACS_EDGE_BYTES;
+
+  static inline SInt EdgeBytes(SInt source, SInt target) {
+    return TextFormat::NumDigits(source + 1) + TextFormat::NumDigits(target + 1) + 4;
+  }
+
+  static inline char* WriteEdge(char* out, SInt source, SInt target) {
+    return TextFormat::WriteDimacsEdge(out, source + 1, target + 1);
+  }
+
+  // Fixed width headers can be rewritten once the edge count is known
+  static std::string Header(SInt n, SInt m, bool fixed_width) {
+    char line[MAX_EDGE_BYTES];
+    return std::string(line, TextFormat::WriteDimacsHeader(line, n, m, fixed_width));
+  }
+};
+
+struct EdgeListWriter {
+  static constexpr SInt MAX_EDGE_BYTES = TextFormat::MAX_EDGE_LIST_BYTES;
+
+  static inline SInt EdgeBytes(SInt source, SInt target) {
+    return TextFormat::NumDigits(source) + TextFormat::NumDigits(target) + 2;
+  }
+
+  static inline char* WriteEdge(char* out, SInt source, SInt target) {
+    return TextFormat::WriteEdgeListEdge(out, source, target);
+  }
+
+  static std::string Header(SInt, SInt, bool) { return ""; }
+};
+
+struct BinaryWriter {
+  static constexpr SInt MAX_EDGE_BYTES = 2 * sizeof(SInt);
+
+  static inline SInt EdgeBytes(SInt, SInt) { return MAX_EDGE_BYTES; }
+
+  static inline char* WriteEdge(char* out, SInt source, SInt target) {
+    source++;
+    target++;
+    memcpy(out, &source, sizeof(SInt));
+    memcpy(out + sizeof(SInt), &target, sizeof(SInt));
+    return out + MAX_EDGE_BYTES;
+  }
+
+  static std::string Header(SInt n, SInt m, bool) {
+    std::string header(2 * sizeof(SInt), 0);
+    memcpy(&header[0], &n, sizeof(SInt));
+    memcpy(&header[sizeof(SInt)], &m, sizeof(SInt));
+    return header;
+  }
+};
+
+// Same header as BinaryWriter, vertex IDs are written with 32 bits
+struct Binary32Writer {
+  static constexpr SInt MAX_EDGE_BYTES = 2 * sizeof(UINT);
+
+  static inline SInt EdgeBytes(SInt, SInt) { return MAX_EDGE_BYTES; }
+
+  static inline char* WriteEdge(char* out, SInt source, SInt target) {
+    UINT ids[2] = {(UINT)(source + 1), (UINT)(target + 1)};
+    memcpy(out, ids, MAX_EDGE_BYTES);
+    return out + MAX_EDGE_BYTES;
+  }
+
+  static std::string Header(SInt n, SInt m, bool fixed_width) {
+    return BinaryWriter::Header(n, m, fixed_width);
+  }
+};
+
+}
+#endif
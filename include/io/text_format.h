@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * include/io/text_format.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _TEXT_FORMAT_H_
+#define _TEXT_FORMAT_H_
+
+#include <cstring>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Integer to ASCII formatting for text output
+// Digits are emitted two at a time from a lookup table directly into the
+// output buffer; callers have to reserve enough space (see MAX_* below)
+class TextFormat {
+ public:
+  static constexpr SInt MAX_UINT_BYTES = 20;
+  // "e " + id + " " + id + "\n"
+  static constexpr SInt MAX_DIMACS_EDGE_BYTES = 2 * MAX_UINT_BYTES + 4;
+  // id + " " + id + "\n"
+  static constexpr SInt MAX_EDGE_LIST_BYTES = 2 * MAX_UINT_BYTES + 2;
+
+  static inline SInt NumDigits(SInt value) {
+    SInt digits = 1;
+    while (true) {
+      if (value < 10) return digits;
+      if (value < 100) return digits + 1;
+      if (value < 1000) return digits + 2;
+      if (value < 10000) return digits + 3;
+      value /= 10000;
+      digits += 4;
+    }
+  }
+
+  // Write value and return the position behind the last digit
+  static inline char* WriteUInt(char* out, SInt value) {
+    char* end = out + NumDigits(value);
+    char* pos = end;
+    while (value >= 100) {
+      const SInt index = (value % 100) * 2;
+      value /= 100;
+      pos -= 2;
+      memcpy(pos, DigitPairs() + index, 2);
+    }
+    if (value >= 10) {
+      memcpy(pos - 2, DigitPairs() + value * 2, 2);
+    } else {
+      *(pos - 1) = '0' + value;
+    }
+    return end;
+  }
+
+  // DIMACS "p n m", with fixed_width m is right-aligned to MAX_UINT_BYTES
+  // characters so the header can be overwritten in place
+  static inline char* WriteDimacsHeader(char* out, SInt n, SInt m,
+                                        bool fixed_width = false) {
+    *out++ = 'p';
+    *out++ = ' ';
+    out = WriteUInt(out, n);
+    *out++ = ' ';
+    if (fixed_width)
+      for (SInt digits = NumDigits(m); digits < MAX_UINT_BYTES; ++digits)
+        *out++ = ' ';
+    out = WriteUInt(out, m);
+    *out++ = '\n';
+    return out;
+  }
+
+  // DIMACS "e u v"
+  static inline char* WriteDimacsEdge(char* out, SInt source, SInt target) {
+    *out++ = 'e';
+    *out++ = ' ';
+    out = WriteUInt(out, source);
+    *out++ = ' ';
+    out = WriteUInt(out, target);
+    *out++ = '\n';
+    return out;
+  }
+
+  // Plain "u v"
+  static inline char* WriteEdgeListEdge(char* out, SInt source, SInt target) {
+    out = WriteUInt(out, source);
+    *out++ = ' ';
+    out = WriteUInt(out, target);
+    *out++ = '\n';
+    return out;
+  }
+
+  // METIS adjacency line, requires (MAX_UINT_BYTES + 1) bytes per neighbor
+  // (and at least one byte for empty lines)
+  static inline char* WriteMetisLine(char* out, const SInt* begin,
+                                     const SInt* end) {
+    if (begin == end) {
+      *out++ = '\n';
+      return out;
+    }
+    for (const SInt* it = begin; it != end; ++it) {
+      out = WriteUInt(out, *it);
+      *out++ = ' ';
+    }
+    *(out - 1) = '\n';
+    return out;
+  }
+
+ private:
+  static inline const char* DigitPairs() {
+    static const char pairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+    return pairs;
+  }
+};
+
+}
+#endif
@@ -0,0 +1,48 @@
+/*******************************************************************************
+ * include/tools/chunk_parallel.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _CHUNK_PARALLEL_H_
+#define _CHUNK_PARALLEL_H_
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Number of threads that get at least one of num_chunks chunks
+inline SInt ChunkThreads(SInt threads, SInt num_chunks) {
+  return std::max((SInt)1, std::min(threads, num_chunks));
+}
+
+// Split the chunks [begin, end) into contiguous blocks and call
+// work(thread, block_begin, block_end) for each block on its own thread.
+// Block 0 runs on the calling thread. Workers must not call MPI.
+template <typename F>
+void ParallelChunks(SInt threads, SInt begin, SInt end, F&& work) {
+  SInt num_chunks = end - begin;
+  threads = ChunkThreads(threads, num_chunks);
+
+  auto block_begin = [&](SInt t) {
+    return begin + t * (num_chunks / threads) +
+           std::min(t, num_chunks % threads);
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (SInt t = 1; t < threads; ++t)
+    workers.emplace_back(
+        [&work, t, &block_begin]() { work(t, block_begin(t), block_begin(t + 1)); });
+  work((SInt)0, block_begin(0), block_begin(1));
+  for (auto& worker : workers) worker.join();
+}
+
+}
+#endif
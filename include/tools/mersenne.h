@@ -10,14 +10,19 @@
 #define _MERSENNE_H_
 
 #include <random>
+#include <type_traits>
+
+#include "random_variates.h"
+#include "rng_policy.h"
 
 namespace kagen {
 
-class Mersenne {
+template <typename Policy = DefaultRNGPolicy>
+class MersenneT {
  public:
-  Mersenne() { Mersenne(0); };
+  MersenneT() { MersenneT(0); };
 
-  Mersenne(SInt seed) : gen_(seed), dis_(0.0, 1.0){};
+  MersenneT(SInt seed) : gen_(seed), dis_(0.0, 1.0){};
 
   void RandomInit(SInt seed) { gen_.seed(seed); }
 
@@ -28,7 +33,12 @@ class Mersenne {
 
   SInt BRandom() { return gen_(); }
 
-  double Random() { return dis_(gen_); }
+  double Random() { return Uniform(typename Policy::PortableVariates()); }
+
+  // Same values as count calls of Random()
+  void Fill(double *out, SInt count) {
+    Fill(typename Policy::PortableVariates(), out, count);
+  }
 
   SInt IRandom(SInt min, SInt max) {
     if (max == min) return min;
@@ -38,9 +48,23 @@ class Mersenne {
   }
 
  private:
-  std::mt19937_64 gen_;
+  typename Policy::Engine64 gen_;
   std::uniform_real_distribution<double> dis_;
+
+  void Fill(std::true_type, double *out, SInt count) {
+    RandomVariates::FillUniform(gen_, out, count);
+  }
+
+  void Fill(std::false_type, double *out, SInt count) {
+    for (SInt i = 0; i < count; ++i) out[i] = dis_(gen_);
+  }
+
+  double Uniform(std::true_type) { return RandomVariates::Uniform(gen_); }
+
+  double Uniform(std::false_type) { return dis_(gen_); }
 };
 
+typedef MersenneT<> Mersenne;
+
 }
 #endif
@@ -0,0 +1,244 @@
+/*******************************************************************************
+ * include/tools/random_variates.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _RANDOM_VARIATES_H_
+#define _RANDOM_VARIATES_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "definitions.h"
+#include "rng_policy.h"
+
+namespace kagen {
+
+// Portable samplers for discrete distributions
+// Unlike std::binomial_distribution, the results only depend on the engine
+// output (and IEEE log/sqrt), so they are identical across standard
+// libraries. Neither sampler has any per-call setup beyond a few flops.
+class RandomVariates {
+ public:
+  // 64 random bits
+  template <typename Engine>
+  static inline uint64_t Bits(Engine& engine) {
+    if (Engine::max() - Engine::min() >= UINT64_MAX)
+      return engine() - Engine::min();
+    // 32 bit engine
+    uint64_t bits = (uint64_t)(engine() - Engine::min()) << 32;
+    return bits | ((uint64_t)(engine() - Engine::min()) & 0xFFFFFFFF);
+  }
+
+  // Uniform double in (0, 1) from 53 random bits
+  template <typename Engine>
+  static inline LPFloat Uniform(Engine& engine) {
+    return ToUniform(Bits(engine));
+  }
+
+  // Unbiased uniform integer in [0, range), range > 0
+  // Multiply-shift with rejection of the biased low products (Lemire 2019)
+  template <typename Engine>
+  static inline SInt UniformInt(Engine& engine, SInt range) {
+    LInt product = (LInt)Bits(engine) * range;
+    if ((SInt)product < range) {
+      SInt threshold = (0 - range) % range;
+      while ((SInt)product < threshold) product = (LInt)Bits(engine) * range;
+    }
+    return (SInt)(product >> 64);
+  }
+
+  static inline LPFloat ToUniform(uint64_t bits) {
+    return ((LPFloat)(bits >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+  }
+
+  // count uniform doubles, same as count calls of Uniform()
+  template <typename Engine>
+  static void FillUniform(Engine& engine, LPFloat* out, SInt count) {
+    for (SInt i = 0; i < count; ++i) out[i] = Uniform(engine);
+  }
+
+  static void FillUniform(Philox4x32& engine, LPFloat* out, SInt count) {
+    uint64_t bits[256];
+    while (count > 0) {
+      SInt batch = count < 256 ? count : 256;
+      engine.Fill(bits, batch);
+      for (SInt i = 0; i < batch; ++i) out[i] = ToUniform(bits[i]);
+      out += batch;
+      count -= batch;
+    }
+  }
+
+  // Binomial(n, p)
+  // Inversion for n * min(p, 1 - p) < 10, otherwise BTRS (Hoermann 1993)
+  // with the Stirling-corrected acceptance bound of BTRD
+  template <typename Engine>
+  static SInt Binomial(Engine& engine, SInt n, LPFloat p) {
+    if (n == 0 || p <= 0.0) return 0;
+    if (p >= 1.0) return n;
+    bool flip = p > 0.5;
+    if (flip) p = 1.0 - p;
+    SInt k = (n * p < 10.0) ? BinomialInversion(engine, n, p)
+                            : BinomialBTRS(engine, n, p);
+    return flip ? n - k : k;
+  }
+
+  // Number of good items in sample draws without replacement from
+  // good + bad items
+  // Inversion for small samples, otherwise HRUA (Stadlober 1989)
+  template <typename Engine>
+  static SInt Hypergeometric(Engine& engine, SInt good, SInt bad, SInt sample) {
+    SInt total = good + bad;
+    if (sample == 0 || good == 0) return 0;
+    if (bad == 0) return std::min(sample, good);
+    if (sample >= total) return good;
+
+    // Sample at most half of the items and count the rarer kind
+    SInt draws = std::min(sample, total - sample);
+    SInt rare = std::min(good, bad);
+    SInt common = std::max(good, bad);
+    SInt k = (draws <= 10) ? HypergeometricInversion(engine, rare, total, draws)
+                           : HypergeometricHRUA(engine, rare, common, draws);
+    if (good > bad) k = draws - k;
+    if (draws < sample) k = good - k;
+    return k;
+  }
+
+ private:
+  static constexpr LPFloat HALF_LOG_2PI = 0.91893853320467274178;
+
+  // Stirling series error fc(k) = log(k!) - log(sqrt(2pi)) - (k + 0.5) log(k + 1) + k + 1
+  static inline LPFloat StirlingCorrection(SInt k) {
+    static const LPFloat table[10] = {
+        0.08106146679532726, 0.04134069595540929, 0.02767792568499834,
+        0.02079067210376509, 0.01664469118982119, 0.01387612882307075,
+        0.01189670994589177, 0.01041126526197209, 0.009255462182712733,
+        0.008330563433362871};
+    if (k < 10) return table[k];
+    LPFloat k1 = (LPFloat)k + 1.0;
+    LPFloat k1sq = k1 * k1;
+    return (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / k1sq) / k1sq) / k1;
+  }
+
+  static inline LPFloat LogFactorial(SInt k) {
+    LPFloat k1 = (LPFloat)k + 1.0;
+    return ((LPFloat)k + 0.5) * std::log(k1) - k1 + HALF_LOG_2PI +
+           StirlingCorrection(k);
+  }
+
+  // Sequential search from zero, p <= 0.5 and n * p < 10
+  template <typename Engine>
+  static SInt BinomialInversion(Engine& engine, SInt n, LPFloat p) {
+    const LPFloat q = 1.0 - p;
+    const LPFloat s = p / q;
+    const LPFloat a = ((LPFloat)n + 1.0) * s;
+    const LPFloat r0 = std::exp((LPFloat)n * std::log1p(-p));
+    for (;;) {
+      LPFloat u = Uniform(engine);
+      LPFloat r = r0;
+      SInt k = 0;
+      while (u > r) {
+        u -= r;
+        ++k;
+        // Rounding left some mass in the tail: start over
+        if (k > n) break;
+        r *= a / (LPFloat)k - s;
+      }
+      if (k <= n) return k;
+    }
+  }
+
+  // Transformed rejection with squeeze, p <= 0.5 and n * p >= 10
+  template <typename Engine>
+  static SInt BinomialBTRS(Engine& engine, SInt n, LPFloat p) {
+    const LPFloat q = 1.0 - p;
+    const LPFloat r = p / q;
+    const LPFloat spq = std::sqrt((LPFloat)n * p * q);
+    const LPFloat b = 1.15 + 2.53 * spq;
+    const LPFloat a = -0.0873 + 0.0248 * b + 0.01 * p;
+    const LPFloat c = (LPFloat)n * p + 0.5;
+    const LPFloat vr = 0.92 - 4.2 / b;
+    const LPFloat alpha = (2.83 + 5.1 / b) * spq;
+
+    // Mode and log f(mode) terms of the acceptance bound (BTRD step 3.4)
+    const SInt m = (SInt)(((LPFloat)n + 1.0) * p);
+    const LPFloat nm = (LPFloat)(n - m) + 1.0;
+    const LPFloat h = ((LPFloat)m + 0.5) * std::log(((LPFloat)m + 1.0) / (r * nm)) +
+                      StirlingCorrection(m) + StirlingCorrection(n - m);
+
+    for (;;) {
+      LPFloat u = Uniform(engine) - 0.5;
+      LPFloat v = Uniform(engine);
+      LPFloat us = 0.5 - std::fabs(u);
+      LPFloat x = std::floor((2.0 * a / us + b) * u + c);
+      if (x < 0.0 || x > (LPFloat)n) continue;
+      SInt k = (SInt)x;
+      if (us >= 0.07 && v <= vr) return k;
+
+      // log(f(k) / f(m)) via Stirling's formula
+      v = std::log(v * alpha / (a / (us * us) + b));
+      LPFloat nk = (LPFloat)(n - k) + 1.0;
+      LPFloat bound = h + ((LPFloat)n + 1.0) * std::log(nm / nk) +
+                      ((LPFloat)k + 0.5) * std::log(nk * r / ((LPFloat)k + 1.0)) -
+                      StirlingCorrection(k) - StirlingCorrection(n - k);
+      if (v <= bound) return k;
+    }
+  }
+
+  // Simulate the draws one by one
+  template <typename Engine>
+  static SInt HypergeometricInversion(Engine& engine, SInt rare, SInt total,
+                                      SInt draws) {
+    SInt left = rare;
+    SInt remaining = total;
+    for (SInt i = 0; i < draws && left > 0; ++i, --remaining) {
+      if (Uniform(engine) * (LPFloat)remaining < (LPFloat)left) --left;
+    }
+    return rare - left;
+  }
+
+  // Ratio of uniforms, draws <= total / 2 and rare <= common
+  template <typename Engine>
+  static SInt HypergeometricHRUA(Engine& engine, SInt rare, SInt common,
+                                 SInt draws) {
+    const LPFloat D1 = 1.7155277699214135;
+    const LPFloat D2 = 0.8989161620588988;
+    const LPFloat total = (LPFloat)rare + (LPFloat)common;
+    const LPFloat p = (LPFloat)rare / total;
+    const LPFloat q = (LPFloat)common / total;
+    const LPFloat mu = (LPFloat)draws * p;
+    const LPFloat a = mu + 0.5;
+    const LPFloat var = (total - draws) * draws * p * q / (total - 1.0);
+    const LPFloat c = std::sqrt(var + 0.5);
+    const LPFloat h = D1 * c + D2;
+    const SInt m = (SInt)(((LPFloat)draws + 1.0) * ((LPFloat)rare + 1.0) /
+                          (total + 2.0));
+    const LPFloat g = LogFactorial(m) + LogFactorial(rare - m) +
+                      LogFactorial(draws - m) +
+                      LogFactorial(common - draws + m);
+    const LPFloat b = std::min((LPFloat)std::min(draws, rare) + 1.0,
+                               std::floor(a + 16.0 * c));
+
+    for (;;) {
+      LPFloat u = Uniform(engine);
+      LPFloat v = Uniform(engine);
+      LPFloat x = a + h * (v - 0.5) / u;
+      if (x < 0.0 || x >= b) continue;
+      SInt k = (SInt)x;
+      LPFloat t = g - (LogFactorial(k) + LogFactorial(rare - k) +
+                       LogFactorial(draws - k) +
+                       LogFactorial(common - draws + k));
+      // Squeeze acceptance and rejection
+      if (u * (4.0 - u) - 3.0 <= t) return k;
+      if (u * (u - t) >= 1.0) continue;
+      if (2.0 * std::log(u) <= t) return k;
+    }
+  }
+};
+
+}
+#endif
@@ -0,0 +1,178 @@
+/*******************************************************************************
+ * include/tools/rng_policy.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _RNG_POLICY_H_
+#define _RNG_POLICY_H_
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11)
+// The output is a bijection of (key, counter), so seeding only stores the key
+// and resets the counter. Satisfies UniformRandomBitGenerator.
+class Philox4x32 {
+ public:
+  typedef uint64_t result_type;
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  explicit Philox4x32(SInt key = 0, SInt stream = 0) { seed(key, stream); }
+
+  // Independent streams of the same seed differ in the upper counter half
+  void seed(SInt key, SInt stream = 0) {
+    key_[0] = (uint32_t)key;
+    key_[1] = (uint32_t)(key >> 32);
+    counter_[0] = 0;
+    counter_[1] = 0;
+    counter_[2] = (uint32_t)stream;
+    counter_[3] = (uint32_t)(stream >> 32);
+    index_ = 2;
+  }
+
+  void seed(std::seed_seq& seq) {
+    uint32_t key[2];
+    seq.generate(key, key + 2);
+    seed(key[0] | ((SInt)key[1] << 32));
+  }
+
+  result_type operator()() {
+    if (index_ == 2) {
+      Generate();
+      index_ = 0;
+    }
+    return output_[index_++];
+  }
+
+  void discard(SInt z) {
+    for (; z > 0; --z) (*this)();
+  }
+
+  // Same output as count calls of operator()
+  // Full batches of BATCH blocks are computed lane-parallel (vectorizable)
+  void Fill(uint64_t* out, SInt count) {
+    for (; count > 0 && index_ < 2; --count) *out++ = output_[index_++];
+    for (; count >= 2 * BATCH; count -= 2 * BATCH, out += 2 * BATCH)
+      GenerateBatch(out);
+    for (; count > 0; --count) *out++ = (*this)();
+  }
+
+  // Single block of the bijection (checked against the reference KAT in
+  // app/philox_test.cpp)
+  static void Block(const uint32_t in[4], const uint32_t key[2],
+                    uint32_t out[4]) {
+    uint32_t c[4] = {in[0], in[1], in[2], in[3]};
+    uint32_t k[2] = {key[0], key[1]};
+    for (int round = 0; round < 10; ++round) {
+      if (round > 0) {
+        k[0] += W0;
+        k[1] += W1;
+      }
+      uint64_t p0 = (uint64_t)M0 * c[0];
+      uint64_t p1 = (uint64_t)M1 * c[2];
+      uint32_t next[4] = {(uint32_t)(p1 >> 32) ^ c[1] ^ k[0], (uint32_t)p1,
+                          (uint32_t)(p0 >> 32) ^ c[3] ^ k[1], (uint32_t)p0};
+      c[0] = next[0];
+      c[1] = next[1];
+      c[2] = next[2];
+      c[3] = next[3];
+    }
+    out[0] = c[0];
+    out[1] = c[1];
+    out[2] = c[2];
+    out[3] = c[3];
+  }
+
+ private:
+  static constexpr SInt BATCH = 16;
+  static constexpr uint32_t M0 = 0xD2511F53;
+  static constexpr uint32_t M1 = 0xCD9E8D57;
+  static constexpr uint32_t W0 = 0x9E3779B9;
+  static constexpr uint32_t W1 = 0xBB67AE85;
+
+  uint32_t key_[2];
+  uint32_t counter_[4];
+  uint64_t output_[2];
+  int index_;
+
+  void Generate() {
+    uint32_t out[4];
+    Block(counter_, key_, out);
+    output_[0] = out[0] | ((uint64_t)out[1] << 32);
+    output_[1] = out[2] | ((uint64_t)out[3] << 32);
+    if (++counter_[0] == 0) ++counter_[1];
+  }
+
+  // BATCH consecutive blocks, one lane per block (vectorizable)
+  void GenerateBatch(uint64_t* out) {
+    const uint64_t first = counter_[0] | ((uint64_t)counter_[1] << 32);
+    const uint32_t key0 = key_[0], key1 = key_[1];
+    const uint32_t in2 = counter_[2], in3 = counter_[3];
+    for (uint32_t j = 0; j < BATCH; ++j) {
+      uint64_t counter = first + j;
+      uint32_t c0 = (uint32_t)counter, c1 = (uint32_t)(counter >> 32);
+      uint32_t c2 = in2, c3 = in3;
+      uint32_t k0 = key0, k1 = key1;
+      for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = (uint64_t)M0 * c0;
+        uint64_t p1 = (uint64_t)M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+        k0 += W0;
+        k1 += W1;
+      }
+      out[2 * j] = c0 | ((uint64_t)c1 << 32);
+      out[2 * j + 1] = c2 | ((uint64_t)c3 << 32);
+    }
+    counter_[0] = (uint32_t)(first + BATCH);
+    counter_[1] = (uint32_t)((first + BATCH) >> 32);
+  }
+};
+
+// RNG policies
+// Engine is used for single variates (RNGWrapper), Engine64 for streams of
+// uniform variates (Mersenne, SortedMersenne). Both are (re)seeded with
+// seed(SInt) for every chunk, cell or annulus.
+// PortableVariates selects the in-tree binomial/hypergeometric samplers
+// (random_variates.h) over std::binomial_distribution and the sampling
+// library.
+
+// Reference policy: reproduces graphs of previous versions
+struct MersennePolicy {
+  typedef std::mt19937 Engine;
+  typedef std::mt19937_64 Engine64;
+  typedef std::false_type PortableVariates;
+};
+
+// Counter-based policy: seeding is free, which pays off for generators that
+// draw only a few variates per seed (e.g. one Bernoulli per grid edge)
+struct PhiloxPolicy {
+  typedef Philox4x32 Engine;
+  typedef Philox4x32 Engine64;
+  typedef std::true_type PortableVariates;
+};
+
+#ifdef KAGEN_USE_PHILOX
+typedef PhiloxPolicy DefaultRNGPolicy;
+#else
+typedef MersennePolicy DefaultRNGPolicy;
+#endif
+
+}
+#endif
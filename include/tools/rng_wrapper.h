@@ -9,50 +9,152 @@
 #ifndef _RNG_WRAPPER_H_
 #define _RNG_WRAPPER_H_
 
+#include <cmath>
 #include <random>
+#include <type_traits>
 
 #include "methodR.hpp"
+#include "random_variates.h"
+#include "rng_policy.h"
+#include "sampler.h"
+#include "wide_index.h"
 
 namespace kagen {
 
-class RNGWrapper {
+template <typename Policy = DefaultRNGPolicy>
+class RNGWrapperT {
  public:
-  RNGWrapper(const PGeneratorConfig &config)
+  RNGWrapperT(const PGeneratorConfig &config)
       : config_(config),
         rng_(0),
-        hyp_(0) {};
+        hyp_(0),
+        sampler_(config.base_size, config.use_binom) {};
 
-  SInt GenerateHypergeometric(SInt seed, SInt n, SInt m, SInt N) {
+  // Index spaces (n, N) may exceed 64 bits, the 64 bit code paths are taken
+  // whenever they fit
+  SInt GenerateHypergeometric(SInt seed, LInt n, SInt m, LInt N) {
     SInt variate = 0;
     if (config_.use_binom)
       variate = GenerateBinomial(seed, n, (LPFloat)m / N);
     else {
-      hyp_.seed(seed);
       if (m < 1) return 0;
-      variate = hyp_(n, N-n, m);
+      if (WideIndex::Narrow(N))
+        variate = Hypergeometric(typename Policy::PortableVariates(), seed,
+                                 (SInt)n, (SInt)(N - n), m);
+      else
+        variate = WideHypergeometric(seed, n, m, N);
     }
     return variate;
   }
 
-  SInt GenerateBinomial(SInt seed, SInt n, LPFloat p) {
+  SInt GenerateBinomial(SInt seed, LInt n, LPFloat p) {
     rng_.seed(seed);
-    std::binomial_distribution<SInt> bin(n, p);
-    return bin(rng_);
+    if (WideIndex::Narrow(n))
+      return Binomial(typename Policy::PortableVariates(), (SInt)n, p);
+
+    // Sum over blocks of 2^63 trials
+    SInt variate = 0;
+    for (; n > WIDE_BLOCK; n -= WIDE_BLOCK)
+      variate += Binomial(typename Policy::PortableVariates(), WIDE_BLOCK, p);
+    return variate + Binomial(typename Policy::PortableVariates(), (SInt)n, p);
   }
 
+  // callback receives SInt samples if N fits into 64 bits, LInt otherwise
   template <typename F>
-  void GenerateSample(SInt seed, SInt N, SInt n, F &&callback) {
-    sampling::HashSampling<> hs(seed, config_.base_size);
-    sampling::SeqDivideSampling<> sds(hs, config_.base_size, seed, config_.use_binom);
-    sds.sample(N, n, callback);
+  void GenerateSample(SInt seed, LInt N, SInt n, F &&callback) {
+    if (WideIndex::Narrow(N))
+      Sample(typename Policy::PortableVariates(), seed, (SInt)N, n, callback);
+    else
+      sampler_.Sample(seed, N, n, callback);
+  }
+
+  // Keep each of [1, N] with probability p, in ascending order
+  // Geometric skips (Batagelj and Brandes), no sample set is materialized
+  template <typename F>
+  void GenerateSkipSample(SInt seed, LInt N, LPFloat p, F &&callback) {
+    if (WideIndex::Narrow(N))
+      SkipSample(seed, (SInt)N, p, callback);
+    else
+      SkipSample(seed, N, p, callback);
   }
 
  private:
   const PGeneratorConfig &config_;
 
-  std::mt19937 rng_;
+  typename Policy::Engine rng_;
   sampling::hypergeometric_distribution<> hyp_;
+  DivideSampler<typename Policy::Engine> sampler_;
+
+  static constexpr SInt WIDE_BLOCK = (SInt)1 << 63;
+
+  SInt Binomial(std::true_type, SInt n, LPFloat p) {
+    return RandomVariates::Binomial(rng_, n, p);
+  }
+
+  SInt Binomial(std::false_type, SInt n, LPFloat p) {
+    std::binomial_distribution<SInt> bin(n, p);
+    return bin(rng_);
+  }
+
+  SInt Hypergeometric(std::true_type, SInt seed, SInt good, SInt bad,
+                      SInt sample) {
+    rng_.seed(seed);
+    return RandomVariates::Hypergeometric(rng_, good, bad, sample);
+  }
+
+  SInt Hypergeometric(std::false_type, SInt seed, SInt good, SInt bad,
+                      SInt sample) {
+    hyp_.seed(seed);
+    return hyp_(good, bad, sample);
+  }
+
+  // Binomial split, see DivideSampler::DivideWide
+  SInt WideHypergeometric(SInt seed, LInt n, SInt m, LInt N) {
+    SInt variate = GenerateBinomial(seed, m, (LPFloat)n / (LPFloat)N);
+    if (variate > n) variate = n;
+    if (m - variate > N - n) variate = m - (N - n);
+    return variate;
+  }
+
+  template <typename Index, typename F>
+  void SkipSample(SInt seed, Index N, LPFloat p, F &callback) {
+    if (p <= 0.0) return;
+    if (p >= 1.0) {
+      for (Index i = 1; i <= N; ++i) callback(i);
+      return;
+    }
+    rng_.seed(seed);
+    const LPFloat log_q = std::log1p(-p);
+    Index position = 0;
+    for (;;) {
+      LPFloat skip = std::floor(std::log(RandomVariates::Uniform(rng_)) / log_q);
+      if (skip >= (LPFloat)(N - position)) return;
+      position += (Index)skip + 1;
+      callback(position);
+    }
+  }
+
+  template <typename F>
+  void Sample(std::true_type, SInt seed, SInt N, SInt n, F &callback) {
+    sampler_.Sample(seed, N, n, callback);
+  }
+
+  // The sampling library builds new tables for every call, -reuse_sampler
+  // switches to the persistent sampler (different samples for the same seed)
+  template <typename F>
+  void Sample(std::false_type, SInt seed, SInt N, SInt n, F &callback) {
+    if (config_.reuse_sampler) {
+      sampler_.Sample(seed, N, n, callback);
+      return;
+    }
+    SamplerStats::CountAllocation();
+    sampling::HashSampling<> hs(seed, config_.base_size);
+    sampling::SeqDivideSampling<> sds(hs, config_.base_size, seed, config_.use_binom);
+    sds.sample(N, n, callback);
+  }
 };
 
+typedef RNGWrapperT<> RNGWrapper;
+
 }
 #endif
@@ -0,0 +1,186 @@
+/*******************************************************************************
+ * include/tools/sampler.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+#include <atomic>
+#include <vector>
+
+#include "definitions.h"
+#include "hash.hpp"
+#include "random_variates.h"
+#include "wide_index.h"
+
+namespace kagen {
+
+// Allocation counters of the sampling layer (per process)
+// Worker threads share the counters, they are only read after the run.
+struct SamplerStats {
+  // Sampler tables allocated
+  std::atomic<SInt> allocations;
+  // Base cases served by a reset table
+  std::atomic<SInt> reuses;
+
+  static SamplerStats& Get() {
+    static SamplerStats stats;
+    return stats;
+  }
+
+  static void CountAllocation() {
+    Get().allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static void CountReuse() {
+    Get().reuses.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  SamplerStats() : allocations(0), reuses(0) {}
+};
+
+// Floyd's algorithm on an open addressing table
+// The table is sized for the largest base case seen so far and reset by
+// clearing only the occupied slots, so it is allocated once per sampler.
+class HashSampler {
+ public:
+  HashSampler() : shift_(64) {}
+
+  // Call callback(offset + s) for n distinct samples s from [1, N]
+  template <typename Engine, typename F>
+  void Sample(Engine& engine, SInt N, SInt n, SInt offset, F&& callback) {
+    Reserve(n);
+    for (SInt j = N - n + 1; j <= N; ++j) {
+      SInt t = RandomVariates::UniformInt(engine, j) + 1;
+      // All previous samples are below j
+      if (!Insert(t)) Insert(j);
+    }
+    for (SInt pos : used_) {
+      callback(offset + table_[pos]);
+      table_[pos] = EMPTY;
+    }
+    used_.clear();
+  }
+
+ private:
+  static constexpr SInt EMPTY = 0;
+
+  std::vector<SInt> table_;
+  std::vector<SInt> used_;
+  SInt shift_;
+
+  void Reserve(SInt n) {
+    SInt size = 2;
+    while (size < 2 * n) size <<= 1;
+    if (table_.size() >= size) {
+      SamplerStats::CountReuse();
+      return;
+    }
+    table_.assign(size, (SInt)EMPTY);
+    used_.reserve(size / 2);
+    shift_ = 64;
+    for (SInt s = size; s > 1; s >>= 1) shift_--;
+    SamplerStats::CountAllocation();
+  }
+
+  bool Insert(SInt key) {
+    SInt mask = table_.size() - 1;
+    for (SInt pos = (key * 0x9E3779B97F4A7C15ULL) >> shift_;;
+         pos = (pos + 1) & mask) {
+      if (table_[pos] == key) return false;
+      if (table_[pos] == EMPTY) {
+        table_[pos] = key;
+        used_.push_back(pos);
+        return true;
+      }
+    }
+  }
+};
+
+// Sequential divide and conquer sampling of n out of [1, N]
+// The range is halved with a hypergeometric (or binomial) split until at
+// most base_size samples remain. Every subproblem is seeded from
+// (seed, offset, N), the engine and base case table are reused across calls.
+template <typename Engine>
+class DivideSampler {
+ public:
+  DivideSampler(SInt base_size, bool use_binom)
+      : base_size_(base_size), use_binom_(use_binom) {}
+
+  template <typename F>
+  void Sample(SInt seed, SInt N, SInt n, F&& callback) {
+    Divide(seed, N, n, 0, callback);
+  }
+
+  // Ranges beyond 64 bits are halved with binomial splits until they fit,
+  // callback receives LInt samples
+  template <typename F>
+  void Sample(SInt seed, LInt N, SInt n, F&& callback) {
+    DivideWide(seed, N, n, 0, callback);
+  }
+
+ private:
+  Engine engine_;
+  HashSampler base_;
+  SInt base_size_;
+  bool use_binom_;
+
+  template <typename F>
+  void Divide(SInt seed, SInt N, SInt n, SInt offset, F& callback) {
+    if (n == 0) return;
+    SInt h = sampling::Spooky::hash(seed + sampling::Spooky::hash(offset));
+    if (n <= base_size_) {
+      engine_.seed(h);
+      base_.Sample(engine_, N, n, offset, callback);
+      return;
+    }
+    if (n >= N) {
+      for (SInt i = 1; i <= N; ++i) callback(offset + i);
+      return;
+    }
+
+    SInt left = N / 2;
+    engine_.seed(sampling::Spooky::hash(h + N));
+    SInt n_left;
+    if (use_binom_) {
+      n_left = RandomVariates::Binomial(engine_, n, (LPFloat)left / N);
+      // Keep both halves feasible
+      if (n_left > left) n_left = left;
+      if (n - n_left > N - left) n_left = n - (N - left);
+    } else {
+      n_left = RandomVariates::Hypergeometric(engine_, left, N - left, n);
+    }
+    Divide(seed, left, n_left, offset, callback);
+    Divide(seed, N - left, n - n_left, offset + left, callback);
+  }
+
+  // Samples are sparse in such ranges (n < 2^64 < N), so the splits are
+  // binomial: they only lack the finite population correction 1 - n / N
+  template <typename F>
+  void DivideWide(SInt seed, LInt N, SInt n, LInt offset, F& callback) {
+    if (n == 0) return;
+    SInt h = sampling::Spooky::hash(seed + WideIndex::Seed(offset));
+    if (WideIndex::Narrow(N)) {
+      auto shifted = [&](SInt sample) { callback(offset + sample); };
+      Divide(h, (SInt)N, n, 0, shifted);
+      return;
+    }
+
+    LInt left = N / 2;
+    engine_.seed(sampling::Spooky::hash(h + WideIndex::Seed(N)));
+    SInt n_left =
+        RandomVariates::Binomial(engine_, n, (LPFloat)left / (LPFloat)N);
+    if (n_left > left) n_left = left;
+    if (n - n_left > N - left) n_left = n - (N - left);
+    DivideWide(seed, left, n_left, offset, callback);
+    DivideWide(seed, N - left, n - n_left, offset + left, callback);
+  }
+};
+
+}
+#endif
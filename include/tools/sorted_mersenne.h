@@ -10,14 +10,19 @@
 #define _SORTED_MERSENNE_H_
 
 #include <random>
+#include <type_traits>
+
+#include "random_variates.h"
+#include "rng_policy.h"
 
 namespace kagen {
 
-class SortedMersenne {
+template <typename Policy = DefaultRNGPolicy>
+class SortedMersenneT {
  public:
-  SortedMersenne() { SortedMersenne(0); };
+  SortedMersenneT() { SortedMersenneT(0); };
 
-  SortedMersenne(SInt seed)
+  SortedMersenneT(SInt seed)
       : gen_(seed), dis_(0.0, 1.0), num_samples_(100), ln_cur_max_(0.0){};
 
   void RandomInit(SInt seed, SInt samples) {
@@ -34,7 +39,7 @@ class SortedMersenne {
   SInt BRandom() { return gen_(); }
 
   double Random() {
-    double rand = dis_(gen_);
+    double rand = Uniform(typename Policy::PortableVariates());
     ln_cur_max_ += std::log(rand) / (double)num_samples_;
     num_samples_--;
     return std::exp(ln_cur_max_);
@@ -48,12 +53,18 @@ class SortedMersenne {
   }
 
  private:
-  std::mt19937_64 gen_;
+  typename Policy::Engine64 gen_;
   std::uniform_real_distribution<double> dis_;
 
+  double Uniform(std::true_type) { return RandomVariates::Uniform(gen_); }
+
+  double Uniform(std::false_type) { return dis_(gen_); }
+
   SInt num_samples_;
   double ln_cur_max_;
 };
 
+typedef SortedMersenneT<> SortedMersenne;
+
 }
 #endif
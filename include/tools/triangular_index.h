@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * include/tools/triangular_index.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _TRIANGULAR_INDEX_H_
+#define _TRIANGULAR_INDEX_H_
+
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+#include "definitions.h"
+
+namespace kagen {
+
+// Exact decoding of lower triangular indices
+// Index s enumerates the entries (i, j), j <= i, row by row:
+// s = i (i + 1) / 2 + j
+class TriangularIndex {
+ public:
+  // i (i + 1) / 2 without overflowing the intermediate product
+  static inline SInt Triangle(SInt i) {
+    return (i >> 1) * (i + 1) + (i & 1) * ((i + 1) >> 1);
+  }
+
+  static inline LInt Triangle(LInt i) {
+    return (i >> 1) * (i + 1) + (i & 1) * ((i + 1) >> 1);
+  }
+
+  // The double estimate of the row is off by at most one, a single
+  // correction step makes it exact
+  // Valid for s < 2^64 - 2^33
+  static inline void Decode(SInt s, SInt& i, SInt& j) {
+    SInt r = (SInt)((std::sqrt(8.0 * (double)s + 1.0) - 1.0) * 0.5);
+    SInt t = Triangle(r);
+    // Triangle(r - 1) = t - r, Triangle(r + 1) = t + r + 1
+    SInt down = t > s;
+    SInt up = (s - t > r) & !down;
+    i = r - down + up;
+    j = s - t + down * r - up * (r + 1);
+  }
+
+  // 128 bit indices: one Newton step on the double estimate, then correct
+  static inline void Decode(LInt s, LInt& i, LInt& j) {
+    if ((s >> 63) == 0) {
+      SInt i64, j64;
+      Decode((SInt)s, i64, j64);
+      i = i64;
+      j = j64;
+      return;
+    }
+    LInt r = (LInt)((std::sqrt(8.0 * (double)s + 1.0) - 1.0) * 0.5);
+    LInt t = Triangle(r);
+    if (t > s)
+      r -= (t - s) / (r + 1);
+    else
+      r += (s - t) / (r + 1);
+    while (Triangle(r) > s) --r;
+    while (s - Triangle(r) > r) ++r;
+    i = r;
+    j = s - Triangle(r);
+  }
+
+  // Decode count indices at once (vectorizable)
+  static void Decode(const SInt* s, SInt count, SInt* i, SInt* j) {
+    for (SInt k = 0; k < count; ++k) Decode(s[k], i[k], j[k]);
+  }
+};
+
+// Collects triangular indices from a sampler and decodes them in batches
+// emit(i, j) is called in the order the indices were pushed
+class TriangularBatch {
+ public:
+  static constexpr SInt BATCH = 1024;
+
+  // Samplers may hand out any unsigned type, only 128 bit indices are wide
+  template <typename Index, typename F>
+  void Push(Index index, F&& emit) {
+    Push(index, emit, std::integral_constant<bool, (sizeof(Index) > sizeof(SInt))>());
+  }
+
+  template <typename F>
+  void Flush(F&& emit) {
+    SInt count = indices_.size();
+    rows_.resize(count);
+    columns_.resize(count);
+    TriangularIndex::Decode(indices_.data(), count, rows_.data(),
+                            columns_.data());
+    for (SInt k = 0; k < count; ++k) emit(rows_[k], columns_[k]);
+    indices_.clear();
+  }
+
+ private:
+  std::vector<SInt> indices_, rows_, columns_;
+
+  template <typename F>
+  void Push(SInt index, F& emit, std::false_type) {
+    indices_.push_back(index);
+    if (indices_.size() == BATCH) Flush(emit);
+  }
+
+  // Wide indices are decoded right away
+  template <typename F>
+  void Push(LInt index, F& emit, std::true_type) {
+    LInt i, j;
+    TriangularIndex::Decode(index, i, j);
+    emit((SInt)i, (SInt)j);
+  }
+};
+
+}
+#endif
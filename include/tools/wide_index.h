@@ -0,0 +1,33 @@
+/*******************************************************************************
+ * include/tools/wide_index.h
+ *
+ * Copyright (C) 2016-2017 Sebastian Lamm <lamm@ira.uka.de>
+ *
+ * All rights reserved. Published under the BSD-2 license in the LICENSE file.
+ ******************************************************************************/
+
+#ifndef _WIDE_INDEX_H_
+#define _WIDE_INDEX_H_
+
+#include "definitions.h"
+#include "hash.hpp"
+
+namespace kagen {
+
+// Helpers for 128 bit index spaces (edge positions of chunks with more
+// than 2^32 vertices)
+class WideIndex {
+ public:
+  // Fits into SInt, i.e. the 64 bit code path applies
+  static inline bool Narrow(LInt x) { return (x >> 64) == 0; }
+
+  // 64 bit seed of an index, the identity for narrow indices
+  static inline SInt Seed(LInt x) {
+    SInt high = (SInt)(x >> 64);
+    if (high == 0) return (SInt)x;
+    return (SInt)x + sampling::Spooky::hash(high);
+  }
+};
+
+}
+#endif
@@ -10,7 +10,10 @@
 #define _KAGEN_INTERFACE_H_
 
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <mpi.h>
+#include <type_traits>
 
 #include "definitions.h"
 #include "generator_config.h"
@@ -30,22 +33,31 @@
 
 #include "barabassi/barabassi.h"
 
+#include "io/csr_graph.h"
+
 namespace kagen {
 
-typedef std::vector<std::pair<SInt, SInt>> EdgeList;
+// Edge lists with the vertex range of the PE as first entry
+template <typename VertexID>
+using EdgeListT = std::vector<std::pair<VertexID, VertexID>>;
+typedef EdgeListT<SInt> EdgeList;
+typedef EdgeListT<UINT> EdgeList32;
 
-class KaGen {
+// VertexID is the vertex type of returned edge lists, KaGen32 halves their
+// size but requires n < 2^32
+template <typename VertexID = SInt>
+class KaGenT {
 public:
-  KaGen(const PEID rank, const PEID size) : rank_(rank), size_(size) {
+  KaGenT(const PEID rank, const PEID size) : rank_(rank), size_(size) {
     SetDefaults();
   }
 
-  virtual ~KaGen() = default;
+  virtual ~KaGenT() = default;
 
-  EdgeList GenerateDirectedGNM(SInt n, SInt m, SInt k = 0, SInt seed = 1,
-                               const std::string& output = "out",
-                               bool self_loops = false) {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateDirectedGNM(SInt n, SInt m, SInt k = 0, SInt seed = 1,
+                                          const std::string& output = "out",
+                                          bool self_loops = false) {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -55,6 +67,8 @@ public:
     config_.output_file = output;
     config_.self_loops = self_loops;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -68,10 +82,10 @@ public:
     return edges;
   }
 
-  EdgeList GenerateUndirectedGNM(SInt n, SInt m, SInt k = 0, SInt seed = 1,
-                                 const std::string& output = "out",
-                                 bool self_loops = false) {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateUndirectedGNM(SInt n, SInt m, SInt k = 0, SInt seed = 1,
+                                            const std::string& output = "out",
+                                            bool self_loops = false) {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -81,6 +95,8 @@ public:
     config_.output_file = output;
     config_.self_loops = self_loops;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -128,10 +144,10 @@ public:
     return result;
   }
 
-  EdgeList GenerateDirectedGNP(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
-                               const std::string& output = "out",
-                               bool self_loops = false) {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateDirectedGNP(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
+                                          const std::string& output = "out",
+                                          bool self_loops = false) {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -141,6 +157,8 @@ public:
     config_.output_file = output;
     config_.self_loops = self_loops;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -154,10 +172,10 @@ public:
     return edges;
   }
 
-  EdgeList GenerateUndirectedGNP(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
-                                 const std::string& output = "out",
-                                 bool self_loops = false) {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateUndirectedGNP(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
+                                            const std::string& output = "out",
+                                            bool self_loops = false) {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -167,6 +185,8 @@ public:
     config_.output_file = output;
     config_.self_loops = self_loops;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -180,9 +200,9 @@ public:
     return edges;
   }
 
-  EdgeList Generate2DRGG(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
-                         const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> Generate2DRGG(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
+                                    const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -191,6 +211,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -234,9 +256,9 @@ public:
     return result;
   }
 
-  EdgeList Generate3DRGG(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
-                         const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> Generate3DRGG(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
+                                    const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -245,6 +267,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -339,9 +363,9 @@ public:
   //    return edges;
   //  }
 
-  EdgeList GenerateBA(SInt n, SInt d, SInt k = 0, SInt seed = 1,
-                      const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateBA(SInt n, SInt d, SInt k = 0, SInt seed = 1,
+                                 const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -350,6 +374,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -363,9 +389,9 @@ public:
     return edges;
   }
 
-  EdgeList GenerateRHG(SInt n, LPFloat gamma, SInt d, SInt k = 0, SInt seed = 1,
-                       const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> GenerateRHG(SInt n, LPFloat gamma, SInt d, SInt k = 0, SInt seed = 1,
+                                  const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.n = n;
@@ -376,6 +402,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(n);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -423,10 +451,10 @@ public:
     return result;
   }
 
-  EdgeList Generate2DGrid(SInt grid_x, SInt grid_y, LPFloat p, bool periodic,
-                          SInt k = 0, SInt seed = 1,
-                          const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> Generate2DGrid(SInt grid_x, SInt grid_y, LPFloat p, bool periodic,
+                                     SInt k = 0, SInt seed = 1,
+                                     const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.grid_x = grid_x;
@@ -437,6 +465,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(grid_x * grid_y);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -485,10 +515,10 @@ public:
     return result;
   }
 
-  EdgeList Generate3DGrid(SInt grid_x, SInt grid_y, SInt grid_z, LPFloat p,
-                          bool periodic, SInt k = 0, SInt seed = 1,
-                          const std::string& output = "out") {
-    EdgeList edges;
+  EdgeListT<VertexID> Generate3DGrid(SInt grid_x, SInt grid_y, SInt grid_z, LPFloat p,
+                                     bool periodic, SInt k = 0, SInt seed = 1,
+                                     const std::string& output = "out") {
+    EdgeListT<VertexID> edges;
 
     // Update config
     config_.grid_x = grid_x;
@@ -500,6 +530,8 @@ public:
     config_.seed = seed;
     config_.output_file = output;
 
+    CheckVertexIDs(grid_x * grid_y * grid_z);
+
     // Edge callback
     auto edge_cb = [&](SInt source, SInt target) {
       edges.emplace_back(source, target);
@@ -549,22 +581,227 @@ public:
     return result;
   }
 
+  // CSR variants
+  // Each PE receives the CSR of its own vertex range with neighbors as local
+  // IDs and a table of ghost vertices, see CSRGraph
+  CSRGraph GenerateDirectedGNMAsCSR(SInt n, SInt m, SInt k = 0, SInt seed = 1,
+                                    const std::string& output = "out",
+                                    bool self_loops = false) {
+    // Update config
+    config_.n = n;
+    config_.m = m;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+    config_.self_loops = self_loops;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<GNMDirected>(false);
+  }
+
+  CSRGraph GenerateUndirectedGNMAsCSR(SInt n, SInt m, SInt k = 0, SInt seed = 1,
+                                      const std::string& output = "out",
+                                      bool self_loops = false) {
+    // Update config
+    config_.n = n;
+    config_.m = m;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+    config_.self_loops = self_loops;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<GNMUndirected>(false);
+  }
+
+  CSRGraph GenerateDirectedGNPAsCSR(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
+                                    const std::string& output = "out",
+                                    bool self_loops = false) {
+    // Update config
+    config_.n = n;
+    config_.p = p;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+    config_.self_loops = self_loops;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<GNPDirected>(false);
+  }
+
+  CSRGraph GenerateUndirectedGNPAsCSR(SInt n, LPFloat p, SInt k = 0, SInt seed = 1,
+                                      const std::string& output = "out",
+                                      bool self_loops = false) {
+    // Update config
+    config_.n = n;
+    config_.p = p;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+    config_.self_loops = self_loops;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<GNPUndirected>(false);
+  }
+
+  CSRGraph Generate2DRGGAsCSR(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
+                              const std::string& output = "out") {
+    // Update config
+    config_.n = n;
+    config_.r = r;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<RGG2D>(false);
+  }
+
+  CSRGraph Generate3DRGGAsCSR(SInt n, LPFloat r, SInt k = 0, SInt seed = 1,
+                              const std::string& output = "out") {
+    // Update config
+    config_.n = n;
+    config_.r = r;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<RGG3D>(false);
+  }
+
+  CSRGraph GenerateBAAsCSR(SInt n, SInt d, SInt k = 0, SInt seed = 1,
+                           const std::string& output = "out") {
+    // Update config
+    config_.n = n;
+    config_.min_degree = d;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<Barabassi>(true);
+  }
+
+  CSRGraph GenerateRHGAsCSR(SInt n, LPFloat gamma, SInt d, SInt k = 0,
+                            SInt seed = 1, const std::string& output = "out") {
+    // Update config
+    config_.n = n;
+    config_.plexp = gamma;
+    config_.avg_degree = d;
+    config_.query_both = false;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(n);
+    return GenerateCSR<Hyperbolic>(true);
+  }
+
+  CSRGraph Generate2DGridAsCSR(SInt grid_x, SInt grid_y, LPFloat p, bool periodic,
+                               SInt k = 0, SInt seed = 1,
+                               const std::string& output = "out") {
+    // Update config
+    config_.grid_x = grid_x;
+    config_.grid_y = grid_y;
+    config_.p = p;
+    config_.periodic = periodic;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(grid_x * grid_y);
+    return GenerateCSR<Grid2D>(false);
+  }
+
+  CSRGraph Generate3DGridAsCSR(SInt grid_x, SInt grid_y, SInt grid_z, LPFloat p,
+                               bool periodic, SInt k = 0, SInt seed = 1,
+                               const std::string& output = "out") {
+    // Update config
+    config_.grid_x = grid_x;
+    config_.grid_y = grid_y;
+    config_.grid_z = grid_z;
+    config_.p = p;
+    config_.periodic = periodic;
+    config_.k = (k == 0 ? config_.k : k);
+    config_.seed = seed;
+    config_.output_file = output;
+
+    CheckVertexIDs(grid_x * grid_y * grid_z);
+    return GenerateCSR<Grid3D>(false);
+  }
+
 private:
   // PE status
   PEID rank_, size_;
 
   PGeneratorConfig config_;
 
+  // Returned vertex IDs have to fit into VertexID (KaGen32: n < 2^32)
+  void CheckVertexIDs(SInt num_vertices) const {
+    if (num_vertices <= (SInt)std::numeric_limits<VertexID>::max()) return;
+    if (rank_ == ROOT)
+      std::cout << "vertex IDs of " << num_vertices
+                << " vertices do not fit into the edge list type" << std::endl;
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Run generator and build the CSR of the local vertex range
+  // BA and RHG emit each undirected edge from one endpoint only and need the
+  // reverse edges added
+  template <template <typename, typename> class Generator>
+  CSRGraph GenerateCSR(bool symmetrize) {
+    EdgeListT<VertexID> edges;
+
+    // Edge callback
+    auto edge_cb = [&](SInt source, SInt target) {
+      edges.emplace_back(source, target);
+    };
+
+    // Init and run generator
+    typedef Generator<decltype(edge_cb), Edge64> Gen;
+    auto gen = CreateGenerator<Gen>(
+        edge_cb, std::is_constructible<Gen, PGeneratorConfig&, const PEID,
+                                       const PEID, const decltype(edge_cb)&>());
+    gen->Generate();
+
+    return BuildCSR(edges, gen->GetVertexRange(), config_.n, symmetrize);
+  }
+
+  // Some generators additionally take the number of PEs
+  template <typename Generator, typename EdgeCallback>
+  std::unique_ptr<Generator> CreateGenerator(const EdgeCallback& cb,
+                                             std::true_type) {
+    return std::unique_ptr<Generator>(new Generator(config_, rank_, size_, cb));
+  }
+
+  template <typename Generator, typename EdgeCallback>
+  std::unique_ptr<Generator> CreateGenerator(const EdgeCallback& cb,
+                                             std::false_type) {
+    return std::unique_ptr<Generator>(new Generator(config_, rank_, cb));
+  }
+
   void SetDefaults() {
     config_.n = 100;
     config_.m = 0;
     config_.k = size_;
+    config_.threads = 1;
+    config_.cell_split = 1;
     config_.seed = 1;
     config_.hash_sample = false;
     config_.use_binom = false;
+    config_.reuse_sampler = false;
+    config_.skip_sampling = false;
     config_.output_file = "out";
+    config_.output_format = "none";
+    config_.single_file = true;
+    config_.omit_header = false;
+    config_.sort_edges = false;
+    config_.redistribute = false;
     config_.debug_output = "dbg";
     config_.dist_size = 10;
+    config_.buffer_mb = 0;
+    config_.direct_io = false;
     config_.p = 0.0;
     config_.self_loops = false;
     config_.r = 0.125;
@@ -580,5 +817,8 @@ private:
   }
 };
 
+typedef KaGenT<SInt> KaGen;
+typedef KaGenT<UINT> KaGen32;
+
 } // namespace kagen
 #endif
@@ -1,5 +1,8 @@
 #!/bin/bash
 
+echo "philox"
+./build/app/philox_test
+
 echo "test generators"
 mkdir test
 